@@ -1,19 +1,55 @@
 #include <pebble.h>
 #include "fpath_builder.h"
+#include "fpath_primitives.h"
 
 #define MAX_POINTS 256
 #define DRAW_LINE false
+#define DRAW_MARKERS false
 #define BENCHMARK false
-#define MAX_DEMO_PATHS 4
+#define GOVERNED false
+#define ANIMATION_INTERVAL 35
+#define MAX_DEMO_PATHS 6
+#define PIPELINE_EDGES_PER_SLICE 32
+#define PIPELINE_ROWS_PER_SLICE 16
 
 static const int rot_step = TRIG_MAX_ANGLE / 360;
 static Window *window;
 static Layer *layer;
 static GPath *s_gpath;
 static FPath *s_fpath;
-static FContext s_fctx;
+static FContext s_fctx_bw;
+#ifdef PBL_COLOR
+static FContext s_fctx_aa;
+#endif
+static FContext *s_fctx = &s_fctx_bw; // the context in use
 static uint8_t path_switcher = 0;
-static enum {DRAW_GPATH, DRAW_FPATH_BW, DRAW_FPATH_AA} draw_line_switcher = DRAW_GPATH;
+static enum {DRAW_GPATH, DRAW_FPATH_BW, DRAW_FPATH_AA, DRAW_FPATH_AREA} draw_line_switcher = DRAW_GPATH;
+
+// The window background is clear, so the frame buffer keeps the last frame,
+// and FPath frames only clear what was drawn last time and what is about to
+// be drawn.  Anything else that changes the screen sets s_clear_all.
+static bool s_clear_all = true;
+static GRect s_last_drawn;
+
+#if GOVERNED && defined(PBL_COLOR)
+// With GOVERNED set, the AA context steps down in quality whenever frames
+// take longer than the animation interval.
+static int32_t s_last_rotation = -1;
+#endif
+
+// Pipelined mode: while the app is idle after a frame, the next frame is
+// rasterized into s_back a slice at a time by s_fctx_next, a context of its
+// own with private flags, so the layer can keep drawing in the meantime.
+// Finished frames are swapped into s_mask, and update_layer only stamps the
+// last one, even if the animation has moved on since.
+static bool s_pipelined = false;
+static FContext s_fctx_next;
+static GBitmap *s_mask;
+static GBitmap *s_back;
+static bool s_mask_ready = false;
+static FPath s_next_fpath; // shares points with s_fpath
+static AppTimer *s_slice_timer;
+static enum {BACK_IDLE, BACK_PLOTTING, BACK_RESOLVING} s_back_state = BACK_IDLE;
 #ifdef PBL_COLOR
 static GColor8 foreground_color;
 static GColor8 background_color;
@@ -31,48 +67,301 @@ static void app_timer_callback(void *data) {
     layer_mark_dirty(layer);
   }
   
-  app_timer_register(35, app_timer_callback, NULL);
+  app_timer_register(ANIMATION_INTERVAL, app_timer_callback, NULL);
+}
+
+static uint32_t prv_isqrt(uint32_t n) {
+  uint32_t root = 0;
+  uint32_t bit = 1u << 30;
+  while (bit > n) bit >>= 2;
+  while (bit) {
+    if (n >= root + bit) {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+// Distance from the path origin to its farthest point, in fixed point.
+static uint32_t prv_path_radius(FPath *fpath) {
+  uint32_t radius = 0;
+  for (uint32_t k = 0; k < fpath->num_points; ++k) {
+    FPoint p = fpath->points[k];
+    uint32_t r = prv_isqrt(p.x * p.x + p.y * p.y);
+    if (r > radius) radius = r;
+  }
+  return radius;
+}
+
+static GPoint prv_mask_origin(void) {
+  GRect bounds = layer_get_bounds(layer);
+  GRect mask_bounds = gbitmap_get_bounds(s_mask);
+  return GPoint(bounds.size.w / 2 - mask_bounds.size.w / 2,
+                bounds.size.h / 2 - mask_bounds.size.h / 2);
+}
+
+// Runs one bounded piece of the next frame's rasterization.
+static void prv_pipeline_slice(void) {
+  switch (s_back_state) {
+  case BACK_PLOTTING:
+    if (fpath_draw_filled_step(&s_fctx_next, &s_next_fpath, PIPELINE_EDGES_PER_SLICE)) {
+      s_back_state = BACK_RESOLVING;
+    }
+    break;
+  case BACK_RESOLVING:
+    if (fpath_end_fill_mask_step(&s_fctx_next, s_back, PIPELINE_ROWS_PER_SLICE)) {
+      GBitmap *done = s_back;
+      s_back = s_mask;
+      s_mask = done;
+      s_mask_ready = true;
+      s_back_state = BACK_IDLE;
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+static void prv_slice_timer_callback(void *data) {
+  s_slice_timer = NULL;
+  prv_pipeline_slice();
+  if (BACK_IDLE != s_back_state) {
+    s_slice_timer = app_timer_register(1, prv_slice_timer_callback, NULL);
+  }
+}
+
+// Drops the masks and any rasterization in progress, without finishing it.
+static void prv_pipeline_discard(void) {
+  if (s_slice_timer) {
+    app_timer_cancel(s_slice_timer);
+    s_slice_timer = NULL;
+  }
+  if (s_back) {
+    fpath_deinit_context(&s_fctx_next);
+    gbitmap_destroy(s_back);
+    s_back = NULL;
+  }
+  if (s_mask) {
+    gbitmap_destroy(s_mask);
+    s_mask = NULL;
+  }
+  s_mask_ready = false;
+  s_back_state = BACK_IDLE;
+}
+
+// Sets up the masks, and a context drawing into them with the renderer and
+// quality of the context in use.
+static bool prv_pipeline_create(void) {
+  // the masks must hold the path at any rotation.
+  int16_t size = 2 * (FIXED_TO_INT(prv_path_radius(s_fpath)) + 2);
+#ifdef PBL_COLOR
+  GBitmapFormat format = fpath_is_context_aa(s_fctx) ? GBitmapFormat8Bit : GBitmapFormat1Bit;
+#else
+  GBitmapFormat format = GBitmapFormat1Bit;
+#endif
+  s_mask = gbitmap_create_blank(GSize(size, size), format);
+  s_back = gbitmap_create_blank(GSize(size, size), format);
+  if (!s_mask || !s_back) {
+    if (s_back) {
+      gbitmap_destroy(s_back);
+      s_back = NULL;
+    }
+    prv_pipeline_discard();
+    return false;
+  }
+
+#ifdef PBL_COLOR
+  if (fpath_is_context_aa(s_fctx)) {
+    fpath_init_context_bitmap_aa(&s_fctx_next, s_back);
+    fpath_set_quality(&s_fctx_next, fpath_get_quality(s_fctx));
+  } else {
+    fpath_init_context_bitmap_bw(&s_fctx_next, s_back);
+  }
+#else
+  fpath_init_context_bitmap_bw(&s_fctx_next, s_back);
+#endif
+  if (!s_fctx_next.flagBuffer || !fpath_use_private_flags(&s_fctx_next)) {
+    prv_pipeline_discard();
+    return false;
+  }
+  return true;
+}
+
+// Starts rasterizing the frame after the current one, unless a frame is
+// still in progress.
+static void prv_pipeline_start(void) {
+  if (BACK_IDLE != s_back_state || (!s_back && !prv_pipeline_create())) {
+    return;
+  }
+
+  GRect mask_bounds = gbitmap_get_bounds(s_back);
+  s_next_fpath = *s_fpath;
+  s_next_fpath.rotation = (s_fpath->rotation + rot_step) % TRIG_MAX_ANGLE;
+  s_next_fpath.offset = FPointI(mask_bounds.size.w / 2, mask_bounds.size.h / 2);
+  fpath_begin_fill(&s_fctx_next);
+  s_back_state = BACK_PLOTTING;
+  s_slice_timer = app_timer_register(1, prv_slice_timer_callback, NULL);
 }
 
+#ifdef FPATH_STATS
+// Overlay the rasterizer counters for everything drawn since the last frame.
+// When pipelined, those of the idle-time rasterization are shown instead,
+// since the layer only stamps masks.
+static void prv_draw_stats(GContext *ctx) {
+  static char text[96];
+  FContext *fctx = s_back ? &s_fctx_next : s_fctx;
+  FStats *stats = &fctx->stats;
+  snprintf(text, sizeof(text), "v%d e%d r%d\nres%d wr%d cap%d\nheap%d t%d p%d r%d",
+           (int)stats->verticesTransformed, (int)stats->edgesSetUp, (int)stats->rowsPlotted,
+           (int)stats->pixelsResolved, (int)stats->pixelsWritten, (int)stats->captures,
+           (int)stats->heapBytes, (int)stats->transformMs, (int)stats->plotMs, (int)stats->resolveMs);
+  graphics_context_set_text_color(ctx, foreground_color);
+  graphics_draw_text(ctx, text, fonts_get_system_font(FONT_KEY_GOTHIC_14),
+                     layer_get_bounds(layer), GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+  fpath_reset_stats(fctx);
+}
+#endif
+
+#if DRAW_MARKERS
+// Twelve hour markers around the path: one shared rectangle, turned into
+// place by the rotation of each instance.
+// 4 by 8 pixels, from 62 to 70 pixels above (0, 0), in fixed point.
+static FPoint s_marker_points[] = { {-32, -1120}, {32, -1120}, {32, -992}, {-32, -992} };
+static FPath s_marker_path = { .num_points = 4, .points = s_marker_points };
+static FGeometry s_marker;
+static FInstance s_markers[12];
+
+static void prv_draw_markers(void) {
+  GRect bounds = layer_get_bounds(layer);
+  for (int k = 0; k < 12; ++k) {
+    s_markers[k].rotation = k * TRIG_MAX_ANGLE / 12;
+    s_markers[k].offset = FPointI(bounds.size.w / 2, bounds.size.h / 2);
+    s_markers[k].color = foreground_color;
+  }
+#ifdef PBL_COLOR
+  s_markers[0].color = GColorRed;
+#endif
+  fpath_draw_instances(s_fctx, &s_marker, s_markers, 12);
+}
+#endif
+
 static void update_layer(struct Layer *layer, GContext *ctx) {
 
+  graphics_context_set_fill_color(ctx, background_color);
+  bool clear_all = s_clear_all || DRAW_GPATH == draw_line_switcher;
+#ifdef FPATH_STATS
+  // the overlay is drawn over the whole layer.
+  clear_all = true;
+#endif
+  if (clear_all) {
+    graphics_fill_rect(ctx, layer_get_bounds(layer), 0, GCornerNone);
+    s_clear_all = false;
+  } else {
+    graphics_fill_rect(ctx, fpath_union_bounds(s_last_drawn, fpath_get_bounds(s_fpath)), 0, GCornerNone);
+  }
+
   if (DRAW_GPATH == draw_line_switcher) {
 
+#if DRAW_LINE
+    graphics_context_set_stroke_color(ctx, foreground_color);
+    gpath_draw_outline(ctx, s_gpath);
+#else
     graphics_context_set_fill_color(ctx, foreground_color);
     gpath_draw_filled(ctx, s_gpath);
+#endif
 
   } else {
 
+    if (NULL == s_fctx_bw.gctx) {
+      fpath_init_context_bw(&s_fctx_bw, ctx);
+#ifdef PBL_COLOR
+      fpath_init_context_aa(&s_fctx_aa, ctx);
+#if GOVERNED
+      fpath_set_frame_budget(&s_fctx_aa, ANIMATION_INTERVAL);
+#endif
+#endif
+    }
+
+    // outlines and the exact area engine have no masks, so they are never
+    // pipelined.
+    bool area = false;
 #ifdef PBL_COLOR
-    bool is_aa = fpath_is_aa_enabled();
-    if (is_aa && DRAW_FPATH_BW == draw_line_switcher) {
-      fpath_deinit_context(&s_fctx);
-      fpath_enable_aa(false);
-    } else if (!is_aa && DRAW_FPATH_AA == draw_line_switcher) {
-      fpath_deinit_context(&s_fctx);
-      fpath_enable_aa(true);
+    area = DRAW_FPATH_AREA == draw_line_switcher;
+    FContext *fctx = DRAW_FPATH_BW == draw_line_switcher ? &s_fctx_bw : &s_fctx_aa;
+    if (fctx != s_fctx || area) {
+      // the masks were rendered for the other context.
+      prv_pipeline_discard();
+      s_fctx = fctx;
     }
 #endif
+    bool pipelined = s_pipelined && !area && !DRAW_LINE;
 
-    if (NULL == s_fctx.gctx) {
-      fpath_init_context(&s_fctx, ctx);
+    fpath_set_stroke_color(s_fctx, background_color);
+    fpath_set_fill_color(s_fctx, foreground_color);
+
+#if GOVERNED && defined(PBL_COLOR)
+    bool governed = &s_fctx_aa == s_fctx && !area;
+    if (governed) {
+      fpath_begin_frame(s_fctx);
     }
+#endif
 
-    fpath_set_stroke_color(&s_fctx, background_color);
-    fpath_set_fill_color(&s_fctx, foreground_color);
-    fpath_begin_fill(&s_fctx);
-    fpath_draw_filled(&s_fctx, s_fpath);
-    fpath_end_fill(&s_fctx);
+    if (pipelined && s_mask_ready) {
+      fpath_draw_mask(s_fctx, s_mask, prv_mask_origin());
+    } else if (DRAW_LINE) {
+      fpath_draw_polyline(s_fctx, s_fpath, true);
+#ifdef PBL_COLOR
+    } else if (area) {
+      fpath_fill_area(s_fctx, s_fpath);
+#endif
+    } else {
+      fpath_begin_fill(s_fctx);
+      fpath_draw_filled(s_fctx, s_fpath);
+      fpath_end_fill(s_fctx);
+    }
+
+    s_last_drawn = fpath_take_drawn(s_fctx);
+
+#if DRAW_MARKERS
+    // the markers are drawn again every frame, so they aren't damage.
+    prv_draw_markers();
+    fpath_take_drawn(s_fctx);
+#endif
+
+#if GOVERNED && defined(PBL_COLOR)
+    bool animating = s_fpath->rotation != s_last_rotation;
+    s_last_rotation = s_fpath->rotation;
+    if (governed && fpath_end_frame(s_fctx, animating)) {
+      // the masks have the format of the last tier.
+      prv_pipeline_discard();
+      if (!animating) {
+        layer_mark_dirty(layer);
+      }
+    }
+#endif
+
+    if (pipelined) {
+      prv_pipeline_start();
+    }
+
+#ifdef FPATH_STATS
+    prv_draw_stats(ctx);
+#endif
   }
 }
 
 static void up_click_handler(ClickRecognizerRef recognizer, void *context) {
   //text_layer_set_text(text_layer, "Up");
 #ifdef PBL_COLOR
-  draw_line_switcher = (draw_line_switcher + 1) % 3;
+  draw_line_switcher = (draw_line_switcher + 1) % 4;
 #else
   draw_line_switcher = (draw_line_switcher + 1) % 2;
 #endif
+  s_clear_all = true;
   layer_mark_dirty(layer);
 }
 
@@ -83,6 +372,15 @@ static void select_click_handler(ClickRecognizerRef recognizer, void *context) {
   layer_mark_dirty(layer);
 }
 
+static void select_long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  s_pipelined = !s_pipelined;
+  if (!s_pipelined) {
+    prv_pipeline_discard();
+  }
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "pipelined rendering %s", s_pipelined ? "on" : "off");
+  layer_mark_dirty(layer);
+}
+
 static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
   //text_layer_set_text(text_layer, "Down");
   if (gcolor_equal(background_color, GColorBlack)) {
@@ -93,17 +391,19 @@ static void down_click_handler(ClickRecognizerRef recognizer, void *context) {
     foreground_color = GColorWhite;
   }
   
-  window_set_background_color(window, background_color);
+  s_clear_all = true;
   layer_mark_dirty(layer);
 }
 
 static void click_config_provider(void *context) {
   window_single_click_subscribe(BUTTON_ID_UP, up_click_handler);
   window_single_click_subscribe(BUTTON_ID_SELECT, select_click_handler);
+  window_long_click_subscribe(BUTTON_ID_SELECT, 0, select_long_click_handler, NULL);
   window_single_click_subscribe(BUTTON_ID_DOWN, down_click_handler);
 }
 
 static void prv_create_path() {
+  prv_pipeline_discard();
   if (s_gpath) {
     gpath_destroy(s_gpath);
   }
@@ -116,6 +416,7 @@ static void prv_create_path() {
   uint16_t start_ms = time_ms(NULL, NULL);
 #endif
   
+  s_clear_all = true;
   FPathBuilder *builder = fpath_builder_create(MAX_POINTS);
   
   switch (path_switcher) {
@@ -147,6 +448,30 @@ static void prv_create_path() {
       fpath_builder_curve_to_point(builder, FPointI(  0,  60), FPointI(-60,  35), FPointI(-35,  60));
       fpath_builder_line_to_point (builder, FPointI(  0, -60));
       break;
+  case 4:
+      fpath_builder_move_to_point (builder, FPointI(  0, -60));
+      fpath_builder_curve_to_point(builder, FPointI( 60,   0), FPointI( 33, -60), FPointI( 60, -33));
+      fpath_builder_curve_to_point(builder, FPointI(  0,  60), FPointI( 60,  33), FPointI( 33,  60));
+      fpath_builder_curve_to_point(builder, FPointI(-60,   0), FPointI(-33,  60), FPointI(-60,  33));
+      fpath_builder_curve_to_point(builder, FPointI(  0, -60), FPointI(-60, -33), FPointI(-33, -60));
+      fpath_builder_move_to_point (builder, FPointI(-25, -25));
+      fpath_builder_line_to_point (builder, FPointI( 25, -25));
+      fpath_builder_line_to_point (builder, FPointI( 25,  25));
+      fpath_builder_line_to_point (builder, FPointI(-25,  25));
+      break;
+  case 5: {
+      // A three quarter progress ring from the primitives, copied into the
+      // builder so that there is a GPath to compare it with.
+      static FPoint ring_points[MAX_POINTS];
+      FPath ring = { .points = ring_points };
+      if (fpath_make_arc(&ring, MAX_POINTS, INT_TO_FIXED(60), INT_TO_FIXED(40), 0, TRIG_MAX_ANGLE * 3 / 4)) {
+        fpath_builder_move_to_point(builder, ring_points[0]);
+        for (uint32_t k = 1; k < ring.num_points; ++k) {
+          fpath_builder_line_to_point(builder, ring_points[k]);
+        }
+      }
+      break;
+  }
   default:
       APP_LOG(APP_LOG_LEVEL_ERROR, "Invalid demo path id: %d", path_switcher);
   }
@@ -176,12 +501,15 @@ static void window_load(Window *window) {
   background_color = GColorBlack;
   
   Layer *window_layer = window_get_root_layer(window);
-  window_set_background_color(window, background_color);
+  window_set_background_color(window, GColorClear);
   GRect bounds = layer_get_bounds(window_layer);
 
   layer = layer_create(bounds);
   layer_set_update_proc(layer, update_layer);
   layer_add_child(window_layer, layer);
+#if DRAW_MARKERS
+  fpath_init_geometry(&s_marker, &s_marker_path);
+#endif
   
   prv_create_path();
   
@@ -189,6 +517,7 @@ static void window_load(Window *window) {
 }
 
 static void window_unload(Window *window) {
+  prv_pipeline_discard();
   gpath_destroy(s_gpath);
   fpath_destroy(s_fpath);
   layer_destroy(layer);
@@ -206,7 +535,10 @@ static void init(void) {
 }
 
 static void deinit(void) {
-  fpath_deinit_context(&s_fctx);
+  fpath_deinit_context(&s_fctx_bw);
+#ifdef PBL_COLOR
+  fpath_deinit_context(&s_fctx_aa);
+#endif
   window_destroy(window);
 }
 
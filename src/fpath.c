@@ -24,11 +24,64 @@
  * The function countBits is Brian Kernighan's alorithm as presented
  * on Sean Eron Anderson's Bit Twiddling Hacks page at
  * http://graphics.stanford.edu/~seander/bithacks.html
+ * which is also the source of the parallel bit count used bytewise in
+ * fpath_resolve_row_aa.
  *
  */
 
 #define Assert(Expression) if(!(Expression)) {*(int *)0 = 0;}
 
+#ifdef FPATH_STATS
+#define STAT_ADD(fctx, field, n) ((fctx)->stats.field += (n))
+#define STAT_WRITTEN(t, n) ((t)->written += (n))
+#define STAT_HEAP(fctx) fpath_update_heap_stat(fctx)
+#define STAT_TIME_BEGIN(stage) uint32_t stage##Begin = fpath_now_ms()
+#define STAT_TIME_END(fctx, stage) ((fctx)->stats.stage##Ms += fpath_now_ms() - stage##Begin)
+#else
+#define STAT_ADD(fctx, field, n)
+#define STAT_WRITTEN(t, n)
+#define STAT_HEAP(fctx)
+#define STAT_TIME_BEGIN(stage)
+#define STAT_TIME_END(fctx, stage)
+#endif
+
+// Resolve the flag buffers several flags at a time (SWAR: SIMD within a
+// register).  The byte order of a word must match the column order, so the
+// plain loops are used on big-endian targets, or with FPATH_SWAR set to 0.
+#ifndef FPATH_SWAR
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define FPATH_SWAR 1
+#else
+#define FPATH_SWAR 0
+#endif
+#endif
+
+// Host builds go wider with SSE2 (and AVX2 for AA rows) where the compiler
+// targets them, and Cortex-M4 builds merge AA pixels into the target with
+// the DSP byte instructions.  Either can be set to 0 to keep to the SWAR
+// loops, which is how the tools check each against the others.
+#ifndef FPATH_SIMD
+#if FPATH_SWAR && defined(__SSE2__)
+#define FPATH_SIMD 1
+#else
+#define FPATH_SIMD 0
+#endif
+#endif
+#ifndef FPATH_DSP
+#if FPATH_SWAR && (defined(__ARM_FEATURE_SIMD32) || defined(__ARM_ARCH_7EM__))
+#define FPATH_DSP 1
+#else
+#define FPATH_DSP 0
+#endif
+#endif
+
+#if FPATH_SIMD
+#include <immintrin.h>
+#endif
+#if FPATH_DSP && !defined(__arm__)
+#include <arm_acle.h>
+#endif
+
 // --------------------------------------------------------------------------
 // FPath drawing support that is shared between bw and aa.
 // --------------------------------------------------------------------------
@@ -49,6 +102,35 @@ void fpath_move_to(FPath* fpath, FPoint point) {
 	fpath->offset = point;
 }
 
+// Only millisecond time is available, so the stage timings are sums of
+// clock ticks seen; short stages are right on average over many frames.
+uint32_t fpath_now_ms() {
+	time_t seconds;
+	uint16_t millis;
+	time_ms(&seconds, &millis);
+	return (uint32_t)seconds * 1000 + millis;
+}
+
+#ifdef FPATH_STATS
+
+void fpath_update_heap_stat(FContext* fctx) {
+	fctx->stats.heapBytes = fctx->pointsCapacity * sizeof(FPoint);
+#ifdef PBL_COLOR
+	fctx->stats.heapBytes += fctx->cellsCapacity * sizeof(int32_t);
+#endif
+	if (fctx->flagBuffer) {
+		GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+		fctx->stats.heapBytes += gbitmap_get_bytes_per_row(fctx->flagBuffer) * bounds.size.h;
+	}
+}
+
+void fpath_reset_stats(FContext* fctx) {
+	uint32_t heapBytes = fctx->stats.heapBytes;
+	memset(&fctx->stats, 0, sizeof(FStats));
+	fctx->stats.heapBytes = heapBytes;
+}
+#endif
+
 void floorDivMod(int32_t numerator, int32_t denominator, int32_t* floor, int32_t* mod ) {
 	Assert(denominator > 0); // we assume it's positive
 	if (numerator >= 0) {
@@ -90,6 +172,460 @@ int32_t edge_step(Edge* e) {
 	return e->height;
 }
 
+// step two rows at once, the same as two edge_steps: as numerator is less
+// than denominator the error term carries at most twice.
+int32_t edge_step2(Edge* e) {
+	e->x += 2 * e->xStep;
+	e->y += 2;
+	e->height -= 2;
+
+	e->errorTerm += 2 * e->numerator;
+	while (e->errorTerm >= e->denominator) {
+		++e->x;
+		e->errorTerm -= e->denominator;
+	}
+	return e->height;
+}
+
+// step rows at once, the same as that many edge_steps: the error term
+// carries the sum of its steps divided by the denominator.
+int32_t edge_skip(Edge* e, int32_t rows) {
+	int64_t errorTerm = e->errorTerm + (int64_t)rows * e->numerator;
+	e->x += rows * e->xStep + (int32_t)(errorTerm / e->denominator);
+	e->errorTerm = (int32_t)(errorTerm % e->denominator);
+	e->y += rows;
+	e->height -= rows;
+	return e->height;
+}
+
+/*
+ * Clip an edge to the rows 0 to rows - 1 of a flag buffer, skipping what
+ * lies above it and cutting off what lies below.  Edges are plotted
+ * whole otherwise, which for a tile of a larger canvas is mostly rows it
+ * doesn't have.
+ */
+void edge_clip_rows(Edge* e, int32_t rows) {
+	if (e->height > 0 && e->y < 0) {
+		edge_skip(e, -e->y < e->height ? -e->y : e->height);
+	}
+	if (e->y + e->height > rows) {
+		e->height = rows > e->y ? rows - e->y : 0;
+	}
+}
+
+/*
+ * Whether an edge can be skipped before it's set up, as it plots nothing a
+ * flag buffer of the given size would resolve: it's wholly above or below
+ * the buffer (it starts on the first row at or below top and ends before
+ * the first row at or below bottom, for BW pixel rows and AA subrows
+ * alike), or it only flags the extra column right of the target.
+ */
+bool edge_outside(FPoint* top, FPoint* bottom, GSize size) {
+	return bottom->y <= 0 || top->y >= INT_TO_FIXED(size.h) ||
+	       (top->x >= INT_TO_FIXED(size.w - 1) && bottom->x >= INT_TO_FIXED(size.w - 1));
+}
+
+typedef void (*edge_init_func)(Edge* e, FPoint* top, FPoint* bottom);
+
+/*
+ * A chain is one side of a y-monotone polygon, walked from the top vertex
+ * to the bottom vertex in the direction given by step (1 for forward, or
+ * num_points - 1 for backward).
+ */
+typedef struct Chain {
+	FPoint* points;
+	uint32_t num_points;
+	uint32_t index;  // vertex at the bottom of the current edge
+	uint32_t bottom;
+	uint32_t step;
+	Edge edge;
+} Chain;
+
+void chain_init(Chain* c, FPoint* points, uint32_t num_points,
+                uint32_t top, uint32_t bottom, uint32_t step) {
+	c->points = points;
+	c->num_points = num_points;
+	c->index = top;
+	c->bottom = bottom;
+	c->step = step;
+	c->edge.height = 0;
+}
+
+// advance to the next edge with rows left to scan, false at the bottom.
+bool chain_advance(Chain* c, edge_init_func init) {
+	while (c->edge.height <= 0) {
+		if (c->index == c->bottom) {
+			return false;
+		}
+		uint32_t next = (c->index + c->step) % c->num_points;
+		init(&c->edge, c->points + c->index, c->points + next);
+		c->index = next;
+	}
+	return true;
+}
+
+/*
+ * A polygon is y-monotone if its y coordinate changes direction at most
+ * twice going around the ring.  Every convex polygon is y-monotone at any
+ * rotation, so this cheap test on the transformed points catches them all.
+ */
+bool fpath_is_y_monotone(FPoint* points, uint32_t num_points) {
+	int32_t first = 0;
+	int32_t dir = 0;
+	uint32_t changes = 0;
+	for (uint32_t k = 0; k < num_points; ++k) {
+		int32_t dy = points[(k+1) % num_points].y - points[k].y;
+		if (dy == 0) continue;
+		int32_t d = dy > 0 ? 1 : -1;
+		if (dir == 0) {
+			first = d;
+		} else if (d != dir) {
+			if (++changes > 2) return false;
+		}
+		dir = d;
+	}
+	if (dir != first) ++changes;
+	return changes <= 2;
+}
+
+// find the indices of the top-most and bottom-most points.
+void fpath_find_extents(FPoint* points, uint32_t num_points, uint32_t* top, uint32_t* bottom) {
+	*top = 0;
+	*bottom = 0;
+	for (uint32_t k = 1; k < num_points; ++k) {
+		if (points[k].y < points[*top].y) *top = k;
+		if (points[k].y > points[*bottom].y) *bottom = k;
+	}
+}
+
+/*
+ * Rotate and translate the path into the context's scratch buffer, growing
+ * the bounding box of the fill as we go.  The buffer is kept between draws
+ * so that it only needs to be reallocated when a bigger path comes along.
+ */
+bool fpath_reserve_points(FContext* fctx, uint32_t num_points) {
+	if (num_points > fctx->pointsCapacity) {
+		FPoint* points = (FPoint*)realloc(fctx->points, num_points * sizeof(FPoint));
+		if (!points) {
+			return false;
+		}
+		fctx->points = points;
+		fctx->pointsCapacity = num_points;
+		STAT_HEAP(fctx);
+	}
+	STAT_ADD(fctx, verticesTransformed, num_points);
+	return true;
+}
+
+FPoint* fpath_transform(FContext* fctx, FPath* fpath, int32_t adjust) {
+
+	if (!fpath_reserve_points(fctx, fpath->num_points)) {
+		return NULL;
+	}
+
+	FPoint* src = fpath->points;
+	FPoint* end = src + fpath->num_points;
+	FPoint* dest = fctx->points;
+	int32_t c = cos_lookup(fpath->rotation);
+	int32_t s = sin_lookup(fpath->rotation);
+	// moving by whole pixels into the target's space keeps the sampling
+	// identical, so a tile renders exactly its part of the full canvas.
+	FPoint offset = FPoint(fpath->offset.x - INT_TO_FIXED(fctx->origin.x) + adjust,
+	                       fpath->offset.y - INT_TO_FIXED(fctx->origin.y) + adjust);
+	while (src != end) {
+		dest->x = (src->x * c / TRIG_MAX_RATIO) - (src->y * s / TRIG_MAX_RATIO);
+		dest->y = (src->x * s / TRIG_MAX_RATIO) + (src->y * c / TRIG_MAX_RATIO);
+		dest->x += offset.x;
+		dest->y += offset.y;
+
+		// grow a bounding box around the points visited.
+		if (dest->x < fctx->min.x) fctx->min.x = dest->x;
+		if (dest->y < fctx->min.y) fctx->min.y = dest->y;
+		if (dest->x > fctx->max.x) fctx->max.x = dest->x;
+		if (dest->y > fctx->max.y) fctx->max.y = dest->y;
+
+		++src;
+		++dest;
+	}
+	return fctx->points;
+}
+
+/*
+ * The same transform for compact paths.  The 16 bit coordinates are only
+ * widened as they are loaded, and an unrotated path is just moved, which
+ * gives exactly what the rotation by zero would.
+ */
+FPoint* fpath_transform16(FContext* fctx, FPath16* fpath, int32_t adjust) {
+
+	if (!fpath_reserve_points(fctx, fpath->num_points)) {
+		return NULL;
+	}
+
+	FPoint16* src = fpath->points;
+	FPoint16* end = src + fpath->num_points;
+	FPoint* dest = fctx->points;
+	FPoint offset = FPoint(fpath->offset.x - INT_TO_FIXED(fctx->origin.x) + adjust,
+	                       fpath->offset.y - INT_TO_FIXED(fctx->origin.y) + adjust);
+	FPoint min = fctx->min;
+	FPoint max = fctx->max;
+	if (fpath->rotation == 0) {
+		for (; src != end; ++src, ++dest) {
+			dest->x = src->x + offset.x;
+			dest->y = src->y + offset.y;
+			if (dest->x < min.x) min.x = dest->x;
+			if (dest->y < min.y) min.y = dest->y;
+			if (dest->x > max.x) max.x = dest->x;
+			if (dest->y > max.y) max.y = dest->y;
+		}
+	} else {
+		int32_t c = cos_lookup(fpath->rotation);
+		int32_t s = sin_lookup(fpath->rotation);
+		for (; src != end; ++src, ++dest) {
+			int32_t x = src->x;
+			int32_t y = src->y;
+			dest->x = (x * c / TRIG_MAX_RATIO) - (y * s / TRIG_MAX_RATIO) + offset.x;
+			dest->y = (x * s / TRIG_MAX_RATIO) + (y * c / TRIG_MAX_RATIO) + offset.y;
+			if (dest->x < min.x) min.x = dest->x;
+			if (dest->y < min.y) min.y = dest->y;
+			if (dest->x > max.x) max.x = dest->x;
+			if (dest->y > max.y) max.y = dest->y;
+		}
+	}
+	fctx->min = min;
+	fctx->max = max;
+	return fctx->points;
+}
+
+FPath16* fpath_create_path16(FPath* fpath) {
+	uint32_t num_contours = fpath->contours && fpath->num_contours > 1 ? fpath->num_contours : 0;
+	FPath16* result = (FPath16*)malloc(sizeof(FPath16) + fpath->num_points * sizeof(FPoint16) +
+	                                   num_contours * sizeof(uint32_t));
+	if (!result) {
+		return NULL;
+	}
+	memset(result, 0, sizeof(FPath16));
+	result->num_points = fpath->num_points;
+	result->points = (FPoint16*)(result + 1);
+	for (uint32_t k = 0; k < fpath->num_points; ++k) {
+		FPoint* p = fpath->points + k;
+		if (p->x < INT16_MIN || p->x > INT16_MAX || p->y < INT16_MIN || p->y > INT16_MAX) {
+			free(result);
+			return NULL;
+		}
+		result->points[k].x = (int16_t)p->x;
+		result->points[k].y = (int16_t)p->y;
+	}
+	result->num_contours = 1;
+	if (num_contours) {
+		result->num_contours = num_contours;
+		result->contours = (uint32_t*)(result->points + fpath->num_points);
+		memcpy(result->contours, fpath->contours, num_contours * sizeof(uint32_t));
+	}
+	result->rotation = fpath->rotation;
+	result->offset = fpath->offset;
+	return result;
+}
+
+void fpath_destroy16(FPath16* fpath) {
+	free(fpath);
+}
+
+int32_t fpath_clamp(int32_t value, int32_t low, int32_t high) {
+	return value < low ? low : value > high ? high : value;
+}
+
+GRect fpath_union_bounds(GRect a, GRect b) {
+	if (grect_is_empty(&a)) return b;
+	if (grect_is_empty(&b)) return a;
+	int32_t x0 = a.origin.x < b.origin.x ? a.origin.x : b.origin.x;
+	int32_t y0 = a.origin.y < b.origin.y ? a.origin.y : b.origin.y;
+	int32_t x1 = a.origin.x + a.size.w > b.origin.x + b.size.w ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+	int32_t y1 = a.origin.y + a.size.h > b.origin.y + b.size.h ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+	return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+/*
+ * The pixels that drawing within [min, max] may touch.  AA coverage and
+ * lines reach into the pixels around the points, so a pixel is added on
+ * each side.
+ */
+GRect fpath_pixel_bounds(FPoint min, FPoint max) {
+	if (min.x > max.x || min.y > max.y) {
+		return GRectZero;
+	}
+	int32_t x0, y0, x1, y1, mod;
+	floorDivMod(min.x, FIXED_POINT_SCALE, &x0, &mod);
+	floorDivMod(min.y, FIXED_POINT_SCALE, &y0, &mod);
+	floorDivMod(max.x, FIXED_POINT_SCALE, &x1, &mod);
+	floorDivMod(max.y, FIXED_POINT_SCALE, &y1, &mod);
+	return GRect(x0 - 1, y0 - 1, x1 - x0 + 3, y1 - y0 + 3);
+}
+
+// add pixels of the target to the drawn bounds, clipped, in canvas coordinates.
+void fpath_add_drawn(FContext* fctx, GRect r) {
+	if (grect_is_empty(&r)) {
+		return;
+	}
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	int32_t x0 = fpath_clamp(r.origin.x, 0, bounds.size.w - 1);
+	int32_t y0 = fpath_clamp(r.origin.y, 0, bounds.size.h - 1);
+	int32_t x1 = fpath_clamp(r.origin.x + r.size.w, 0, bounds.size.w - 1);
+	int32_t y1 = fpath_clamp(r.origin.y + r.size.h, 0, bounds.size.h - 1);
+	if (x0 < x1 && y0 < y1) {
+		r = GRect(x0 + fctx->origin.x, y0 + fctx->origin.y, x1 - x0, y1 - y0);
+		fctx->drawn = fpath_union_bounds(fctx->drawn, r);
+	}
+}
+
+void fpath_add_drawn_points(FContext* fctx, FPoint* points, uint32_t num_points) {
+	if (num_points == 0) {
+		return;
+	}
+	FPoint min = points[0];
+	FPoint max = points[0];
+	for (uint32_t k = 1; k < num_points; ++k) {
+		if (points[k].x < min.x) min.x = points[k].x;
+		if (points[k].y < min.y) min.y = points[k].y;
+		if (points[k].x > max.x) max.x = points[k].x;
+		if (points[k].y > max.y) max.y = points[k].y;
+	}
+	fpath_add_drawn(fctx, fpath_pixel_bounds(min, max));
+}
+
+GRect fpath_get_bounds(FPath* fpath) {
+	if (fpath->num_points == 0) {
+		return GRectZero;
+	}
+	int32_t c = cos_lookup(fpath->rotation);
+	int32_t s = sin_lookup(fpath->rotation);
+	FPoint min = FPoint(INT32_MAX, INT32_MAX);
+	FPoint max = FPoint(INT32_MIN, INT32_MIN);
+	for (uint32_t k = 0; k < fpath->num_points; ++k) {
+		FPoint* src = fpath->points + k;
+		int32_t x = (src->x * c / TRIG_MAX_RATIO) - (src->y * s / TRIG_MAX_RATIO) + fpath->offset.x;
+		int32_t y = (src->x * s / TRIG_MAX_RATIO) + (src->y * c / TRIG_MAX_RATIO) + fpath->offset.y;
+		if (x < min.x) min.x = x;
+		if (y < min.y) min.y = y;
+		if (x > max.x) max.x = x;
+		if (y > max.y) max.y = y;
+	}
+	return fpath_pixel_bounds(min, max);
+}
+
+GRect fpath_take_drawn(FContext* fctx) {
+	GRect drawn = fctx->drawn;
+	fctx->drawn = GRectZero;
+	return drawn;
+}
+
+/*
+ * Plot the edges of each contour, closing each one back on its own first
+ * point.  All contours go into the same flag buffer, so holes simply fall
+ * out of the even-odd resolve.
+ */
+void fpath_plot_edges(FContext* fctx, FPoint* points, uint32_t num_points,
+                      uint32_t num_contours, uint32_t* contours, fpath_plot_edge_func plot) {
+	STAT_TIME_BEGIN(plot);
+	if (!contours || num_contours < 1) {
+		num_contours = 1;
+	}
+	for (uint32_t c = 0; c < num_contours; ++c) {
+		uint32_t begin = contours ? contours[c] : 0;
+		uint32_t end = c + 1 < num_contours ? contours[c + 1] : num_points;
+		for (uint32_t k = begin; k < end; ++k) {
+			plot(fctx, points + k, points + (k + 1 < end ? k + 1 : begin));
+		}
+	}
+	fctx->flagsDirty = true;
+	STAT_TIME_END(fctx, plot);
+}
+
+/*
+ * The first path of a fill is held back in the scratch buffer.  If it turns
+ * out to be the only one, and it is y-monotone, end_fill can span it straight
+ * into the frame buffer.  Otherwise it is flushed into the flag buffer here.
+ */
+void fpath_flush_pending(FContext* fctx, fpath_plot_edge_func plot) {
+	if (fctx->pendingPoints) {
+		fpath_plot_edges(fctx, fctx->points, fctx->pendingPoints, 1, NULL, plot);
+		fctx->pendingPoints = 0;
+	}
+}
+
+void fpath_draw_transformed(FContext* fctx, FPoint* points, uint32_t num_points,
+                            uint32_t num_contours, uint32_t* contours, fpath_plot_edge_func plot) {
+	bool single = !contours || num_contours <= 1;
+	if (single && !fctx->flagsDirty &&
+	    (fctx->convexHint || fpath_is_y_monotone(points, num_points))) {
+		fctx->pendingPoints = num_points;
+	} else {
+		fpath_plot_edges(fctx, points, num_points, num_contours, contours, plot);
+	}
+}
+
+void fpath_draw_filled_common(FContext* fctx, FPath* fpath, int32_t adjust, fpath_plot_edge_func plot) {
+	fpath_flush_pending(fctx, plot);
+	STAT_TIME_BEGIN(transform);
+	FPoint* points = fpath_transform(fctx, fpath, adjust);
+	STAT_TIME_END(fctx, transform);
+	if (points) {
+		fpath_draw_transformed(fctx, points, fpath->num_points,
+		                       fpath->num_contours, fpath->contours, plot);
+	}
+}
+
+/*
+ * Plot a path at most max_edges edges per call, so that a fill can be set up
+ * in idle time like fpath_end_fill_mask_step resolves it.  The first call
+ * transforms the whole path into the scratch points, and the calls after it
+ * carry on from the edge in plotEdge.  Stepped paths are never deferred as
+ * pending points.
+ */
+bool fpath_draw_filled_step(FContext* fctx, FPath* fpath, uint16_t max_edges) {
+	fpath_plot_edge_func plot = fctx->renderer->plot_edge;
+	if (fctx->plotEdge < 0) {
+		fpath_flush_pending(fctx, plot);
+		STAT_TIME_BEGIN(transform);
+		FPoint* points = fpath_transform(fctx, fpath, fctx->renderer->adjust);
+		STAT_TIME_END(fctx, transform);
+		if (!points) {
+			return true;
+		}
+		fctx->plotEdge = 0;
+	}
+	STAT_TIME_BEGIN(plot);
+	FPoint* points = fctx->points;
+	uint32_t num_contours = fpath->contours && fpath->num_contours > 1 ? fpath->num_contours : 1;
+	uint32_t edge = fctx->plotEdge;
+	uint32_t last = edge + max_edges < fpath->num_points ? edge + max_edges : fpath->num_points;
+	for (uint32_t c = 0; c < num_contours && edge < last; ++c) {
+		uint32_t begin = num_contours > 1 ? fpath->contours[c] : 0;
+		uint32_t end = c + 1 < num_contours ? fpath->contours[c + 1] : fpath->num_points;
+		for (; edge < end && edge < last; ++edge) {
+			plot(fctx, points + edge, points + (edge + 1 < end ? edge + 1 : begin));
+		}
+	}
+	fctx->flagsDirty = true;
+	STAT_TIME_END(fctx, plot);
+	if (edge < fpath->num_points) {
+		fctx->plotEdge = edge;
+		return false;
+	}
+	fctx->plotEdge = -1;
+	return true;
+}
+
+void fpath_draw_filled16_common(FContext* fctx, FPath16* fpath, int32_t adjust, fpath_plot_edge_func plot) {
+	fpath_flush_pending(fctx, plot);
+	STAT_TIME_BEGIN(transform);
+	FPoint* points = fpath_transform16(fctx, fpath, adjust);
+	STAT_TIME_END(fctx, transform);
+	if (points) {
+		fpath_draw_transformed(fctx, points, fpath->num_points,
+		                       fpath->num_contours, fpath->contours, plot);
+	}
+}
+
 void fpath_set_stroke_color(FContext* fctx, GColor c) {
 	fctx->strokeColor = c;
 #ifdef PBL_COLOR
@@ -104,6 +640,306 @@ void fpath_set_fill_color(FContext* fctx, GColor c) {
 #endif
 }
 
+/*
+ * The bitmap that a fill resolves into: either the context's own target,
+ * or the frame buffer of its graphics context, captured for the duration.
+ */
+typedef struct Target {
+	GBitmap* bitmap;
+	uint8_t* data;
+	uint16_t stride;
+	int32_t width;
+	int32_t height;
+	bool bw; // 1 bit-per-pixel, otherwise 8 bit-per-pixel
+#ifdef FPATH_STATS
+	uint32_t written;
+#endif
+} Target;
+
+bool fpath_capture_target(FContext* fctx, Target* t) {
+	t->bitmap = fctx->target ? fctx->target : graphics_capture_frame_buffer(fctx->gctx);
+	if (!t->bitmap) {
+		return false;
+	}
+	GRect bounds = gbitmap_get_bounds(t->bitmap);
+	t->data = gbitmap_get_data(t->bitmap);
+	t->stride = gbitmap_get_bytes_per_row(t->bitmap);
+	t->width = bounds.size.w;
+	t->height = bounds.size.h;
+	t->bw = gbitmap_get_format(t->bitmap) == GBitmapFormat1Bit;
+#ifdef FPATH_STATS
+	t->written = 0;
+	if (!fctx->target) {
+		++fctx->stats.captures;
+	}
+#endif
+	return true;
+}
+
+void fpath_release_target(FContext* fctx, Target* t) {
+	STAT_ADD(fctx, pixelsWritten, t->written);
+	if (!fctx->target) {
+		graphics_release_frame_buffer(fctx->gctx, t->bitmap);
+	}
+}
+
+/*
+ * Flag buffers are pooled by size and format, and counted by the number of
+ * contexts using each one.  Private buffers stay out of the pool, so they
+ * can be made and freed without touching the other contexts' buffers.
+ */
+typedef struct FlagBuffer {
+	GBitmap* bitmap;
+	uint32_t refs;
+	struct FlagBuffer* next;
+} FlagBuffer;
+
+static FlagBuffer* flagBufferPool = NULL;
+
+GBitmap* fpath_acquire_flags(GSize size, GBitmapFormat format, bool shared) {
+	if (!shared) {
+		return gbitmap_create_blank(size, format);
+	}
+	FlagBuffer* f;
+	for (f = flagBufferPool; f; f = f->next) {
+		GRect bounds = gbitmap_get_bounds(f->bitmap);
+		if (gbitmap_get_format(f->bitmap) == format &&
+		    bounds.size.w == size.w && bounds.size.h == size.h) {
+			++f->refs;
+			return f->bitmap;
+		}
+	}
+	f = (FlagBuffer*)malloc(sizeof(FlagBuffer));
+	if (!f) {
+		return NULL;
+	}
+	f->bitmap = gbitmap_create_blank(size, format);
+	if (!f->bitmap) {
+		free(f);
+		return NULL;
+	}
+	f->refs = 1;
+	f->next = flagBufferPool;
+	flagBufferPool = f;
+	return f->bitmap;
+}
+
+void fpath_release_flags(GBitmap* bitmap, bool shared) {
+	if (!shared) {
+		gbitmap_destroy(bitmap);
+		return;
+	}
+	for (FlagBuffer** p = &flagBufferPool; *p; p = &(*p)->next) {
+		FlagBuffer* f = *p;
+		if (f->bitmap == bitmap) {
+			if (--f->refs == 0) {
+				*p = f->next;
+				gbitmap_destroy(f->bitmap);
+				free(f);
+			}
+			return;
+		}
+	}
+}
+
+// get a flag buffer one pixel larger than the target in each direction.
+void fpath_init_flags(FContext* fctx, GSize size, GBitmapFormat format) {
+	size.w += 1;
+	size.h += 1;
+	fctx->flagBuffer = fpath_acquire_flags(size, format, true);
+	fctx->privateFlags = false;
+	fctx->flagsDirty = false;
+	fctx->pendingPoints = 0;
+	fctx->plotEdge = -1;
+	fctx->resolveRow = -1;
+	fctx->points = NULL;
+	fctx->pointsCapacity = 0;
+	fctx->origin = GPointZero;
+	fctx->drawn = GRectZero;
+	fctx->convexHint = false;
+#ifdef PBL_COLOR
+	memset(&fctx->governor, 0, sizeof(FGovernor));
+	fctx->cells = NULL;
+	fctx->cellsCapacity = 0;
+#endif
+#ifdef FPATH_STATS
+	memset(&fctx->stats, 0, sizeof(FStats));
+	fpath_update_heap_stat(fctx);
+#endif
+}
+
+bool fpath_use_private_flags(FContext* fctx) {
+	if (!fctx->flagBuffer || fctx->flagsDirty || fctx->pendingPoints) {
+		return false;
+	}
+	if (fctx->privateFlags) {
+		return true;
+	}
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	GBitmap* flags = fpath_acquire_flags(bounds.size, gbitmap_get_format(fctx->flagBuffer), false);
+	if (!flags) {
+		return false;
+	}
+	fpath_release_flags(fctx->flagBuffer, true);
+	fctx->flagBuffer = flags;
+	fctx->privateFlags = true;
+	STAT_HEAP(fctx);
+	return true;
+}
+
+// the fill color as a byte of the target.
+uint8_t fpath_fill_byte(FContext* fctx, Target* t) {
+#ifdef PBL_COLOR
+	if (!t->bw) {
+		return fctx->fillColor.argb;
+	}
+#endif
+	return gcolor_equal(fctx->fillColor, GColorWhite) ? 0xff : 0x00;
+}
+
+// write one pixel of a row of the target.
+void fpath_put(Target* t, uint8_t* row, int32_t x, uint8_t color) {
+	STAT_WRITTEN(t, 1);
+	if (t->bw) {
+		uint8_t mask = 1 << (x % 8);
+		row[x / 8] = (color & mask) | (row[x / 8] & ~mask);
+	} else {
+		row[x] = color;
+	}
+}
+
+// write the pixels [x0, x1) of row y, clipped to the target.
+void fpath_span(Target* t, int32_t y, int32_t x0, int32_t x1, uint8_t color) {
+
+	if (y < 0 || y >= t->height) return;
+	if (x0 < 0) x0 = 0;
+	if (x1 > t->width) x1 = t->width;
+	if (x0 >= x1) return;
+	STAT_WRITTEN(t, x1 - x0);
+
+	uint8_t* row = t->data + t->stride * y;
+	if (!t->bw) {
+		memset(row + x0, color, x1 - x0);
+		return;
+	}
+
+	uint8_t* p = row + x0 / 8;
+	uint8_t* last = row + (x1 - 1) / 8;
+	uint8_t mask = 0xff << (x0 % 8);
+	uint8_t lastMask = 0xff >> (7 - (x1 - 1) % 8);
+	if (p == last) {
+		mask &= lastMask;
+	} else {
+		*p = (color & mask) | (*p & ~mask);
+		for (++p; p != last; ++p) {
+			*p = color;
+		}
+		mask = lastMask;
+	}
+	*p = (color & mask) | (*p & ~mask);
+}
+
+#if FPATH_SWAR
+/*
+ * The inside pixels for a byte of BW flags: the inclusive prefix XOR of
+ * the flag bits, continuing from *inside (0x00 or 0xff) on the left.
+ */
+uint8_t fpath_inside_byte(uint8_t flags, uint8_t* inside) {
+	uint8_t bits = flags ^ (flags << 1);
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= *inside;
+	*inside = (bits & 0x80) ? 0xff : 0x00;
+	return bits;
+}
+
+#if FPATH_SIMD
+uint32_t fpath_popcount128(__m128i v) {
+	uint64_t halves[2];
+	memcpy(halves, &v, sizeof(halves));
+	return __builtin_popcountll(halves[0]) + __builtin_popcountll(halves[1]);
+}
+
+/*
+ * fpath_inside_byte for sixteen bytes of flags at once, from byte k while
+ * the bytes are whole target bytes, before end.  Each byte's own prefix XOR
+ * leaves its parity in its top bit; a prefix XOR of those across the bytes
+ * carries the inside state in.  Returns the byte to continue from.  BW rows
+ * are shorter than an AVX2 register on every display, so there's no wider
+ * version.
+ */
+int32_t fpath_resolve_row_bw_sse2(Target* t, uint8_t* src, uint8_t* dest,
+                                  int32_t k, int32_t end, uint8_t color, uint8_t* inside) {
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i colors = _mm_set1_epi8((char)color);
+	for (; k + 16 <= end; k += 16) {
+		__m128i flags = _mm_loadu_si128((const __m128i*)(src + k));
+		if (!*inside && _mm_movemask_epi8(_mm_cmpeq_epi8(flags, zero)) == 0xffff) {
+			continue;
+		}
+		_mm_storeu_si128((__m128i*)(src + k), zero);
+
+		__m128i bits = _mm_xor_si128(flags, _mm_and_si128(_mm_slli_epi16(flags, 1), _mm_set1_epi8((char)0xfe)));
+		bits = _mm_xor_si128(bits, _mm_and_si128(_mm_slli_epi16(bits, 2), _mm_set1_epi8((char)0xfc)));
+		bits = _mm_xor_si128(bits, _mm_and_si128(_mm_slli_epi16(bits, 4), _mm_set1_epi8((char)0xf0)));
+
+		__m128i parity = _mm_cmplt_epi8(bits, zero);
+		parity = _mm_xor_si128(parity, _mm_slli_si128(parity, 1));
+		parity = _mm_xor_si128(parity, _mm_slli_si128(parity, 2));
+		parity = _mm_xor_si128(parity, _mm_slli_si128(parity, 4));
+		parity = _mm_xor_si128(parity, _mm_slli_si128(parity, 8));
+		bits = _mm_xor_si128(bits, _mm_slli_si128(parity, 1));
+		bits = _mm_xor_si128(bits, _mm_set1_epi8((char)*inside));
+		*inside = (_mm_extract_epi16(bits, 7) & 0x8000) ? 0xff : 0x00;
+
+		if (dest) {
+			__m128i d = _mm_loadu_si128((const __m128i*)(dest + k));
+			d = _mm_or_si128(_mm_and_si128(colors, bits), _mm_andnot_si128(bits, d));
+			_mm_storeu_si128((__m128i*)(dest + k), d);
+			STAT_WRITTEN(t, fpath_popcount128(bits));
+		}
+	}
+	return k;
+}
+#endif
+
+/*
+ * Resolve a row of BW flags into a 1 bit-per-pixel target eight columns at
+ * a time, clearing the flags.  The flag buffer and the target share a bit
+ * order, so each flag byte becomes a target byte mask.  Covers the same
+ * columns, colBegin to colEnd inclusive, as the bitwise loop.
+ */
+void fpath_resolve_row_bw(Target* t, uint8_t* src, int32_t y,
+                          int32_t colBegin, int32_t colEnd, uint8_t color) {
+
+	uint8_t* dest = y < t->height ? t->data + t->stride * y : NULL;
+	int32_t last = colEnd < t->width ? colEnd : t->width - 1;
+	uint8_t inside = 0;
+	int32_t k = colBegin / 8;
+
+#if FPATH_SIMD
+	k = fpath_resolve_row_bw_sse2(t, src, dest, k, (last + 1) / 8, color, &inside);
+#endif
+	for (; k <= colEnd / 8; ++k) {
+		if (!src[k] && !inside) {
+			continue;
+		}
+		uint8_t bits = fpath_inside_byte(src[k], &inside);
+		src[k] = 0;
+
+		int32_t x = k * 8;
+		if (x + 7 > last) {
+			bits &= last < x ? 0 : 0xff >> (7 - (last - x));
+		}
+		if (dest && bits) {
+			dest[k] = (color & bits) | (dest[k] & ~bits);
+			STAT_WRITTEN(t, __builtin_popcount(bits));
+		}
+	}
+}
+#endif
+
 // --------------------------------------------------------------------------
 // BW - black and white drawing with 1 bit-per-pixel flag buffer.
 // --------------------------------------------------------------------------
@@ -137,6 +973,8 @@ void edge_init(Edge* e, FPoint* top, FPoint* bottom) {
 	}
 }
 
+extern const FRenderer fpath_renderer_bw;
+
 void fpath_init_context_bw(FContext* fctx, GContext* gctx) {
 	
 	GBitmap* frameBuffer = graphics_capture_frame_buffer(gctx);
@@ -144,38 +982,67 @@ void fpath_init_context_bw(FContext* fctx, GContext* gctx) {
 		GRect bounds = gbitmap_get_bounds(frameBuffer);
 		graphics_release_frame_buffer(gctx, frameBuffer);
 		
-		bounds.size.w += 1;
-		bounds.size.h += 1;
-		fctx->flagBuffer = gbitmap_create_blank(bounds.size, GBitmapFormat1Bit);
-
+		fpath_init_flags(fctx, bounds.size, GBitmapFormat1Bit);
+		fctx->renderer = &fpath_renderer_bw;
+		fctx->target = NULL;
 		fctx->gctx = gctx;
+#ifdef PBL_COLOR
+		fctx->aarampDirty = true;
+#endif
 	}
 }
 
-void fpath_begin_fill_bw(FContext* fctx) {
+void fpath_init_context_bitmap_bw(FContext* fctx, GBitmap* target) {
+
+	GBitmapFormat format = gbitmap_get_format(target);
+	if (format == GBitmapFormat1Bit || format == GBitmapFormat8Bit) {
+		GRect bounds = gbitmap_get_bounds(target);
+		fpath_init_flags(fctx, bounds.size, GBitmapFormat1Bit);
+		fctx->renderer = &fpath_renderer_bw;
+		fctx->target = target;
+		fctx->gctx = NULL;
+#ifdef PBL_COLOR
+		fctx->aarampDirty = true;
+#endif
+	}
+}
+
+void fpath_begin_fill_bw(FContext* fctx) {
 	
 	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
 	fctx->max.x = INT_TO_FIXED(bounds.origin.x);
 	fctx->max.y = INT_TO_FIXED(bounds.origin.y);
 	fctx->min.x = INT_TO_FIXED(bounds.origin.x + bounds.size.w);
 	fctx->min.y = INT_TO_FIXED(bounds.origin.y + bounds.size.h);
-	}
+	fctx->pendingPoints = 0;
+	fctx->flagsDirty = false;
+	fctx->plotEdge = -1;
+	fctx->resolveRow = -1;
+}
 
 void fpath_plot_edge_bw(FContext* fctx, FPoint* a, FPoint* b) {
 	
-	Edge edge;
-	if (a->y > b->y) {
-		edge_init(&edge, b, a);
-	} else {
-		edge_init(&edge, a, b);
+	FPoint* top = a->y > b->y ? b : a;
+	FPoint* bottom = a->y > b->y ? a : b;
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	if (edge_outside(top, bottom, bounds.size)) {
+		return;
 	}
+	Edge edge;
+	edge_init(&edge, top, bottom);
+	STAT_ADD(fctx, edgesSetUp, 1);
 	
 	uint8_t* data = gbitmap_get_data(fctx->flagBuffer);
 	int16_t stride = gbitmap_get_bytes_per_row(fctx->flagBuffer);
+	edge_clip_rows(&edge, bounds.size.h);
+	STAT_ADD(fctx, rowsPlotted, edge.height);
 	int32_t height = edge.height;
-	while (height--) {
-		uint8_t* p = data + edge.y * stride + edge.x / 8;
-		uint8_t mask = 1 << (edge.x % 8);
+	while (height-- > 0) {
+		// flags left of the buffer are moved onto its first column, which
+		// keeps the parity of every pixel to their right intact.
+		int32_t x = fpath_clamp(edge.x, 0, bounds.size.w - 1);
+		uint8_t* p = data + edge.y * stride + x / 8;
+		uint8_t mask = 1 << (x % 8);
 		*p ^= mask;
 		edge_step(&edge);
 	}
@@ -183,108 +1050,294 @@ void fpath_plot_edge_bw(FContext* fctx, FPoint* a, FPoint* b) {
 }
 
 void fpath_draw_filled_bw(FContext* fctx, FPath* fpath) {
-	
-	// allocate buffer for transformed points.
-	FPoint* points = (FPoint*)malloc(fpath->num_points * sizeof(FPoint));
-	if (points) {
-		
-		// half-pixel offset
-		int32_t adjust = -FIXED_POINT_SCALE / 2;
+	// half-pixel offset
+	fpath_draw_filled_common(fctx, fpath, -FIXED_POINT_SCALE / 2, fpath_plot_edge_bw);
+}
 
-		// rotate and translate the points.
-		FPoint* src = fpath->points;
-		FPoint* end = src + fpath->num_points;
-		FPoint* dest = points;
-		int32_t c = cos_lookup(fpath->rotation);
-		int32_t s = sin_lookup(fpath->rotation);
-		while (src != end) {
-			dest->x = (src->x * c / TRIG_MAX_RATIO) - (src->y * s / TRIG_MAX_RATIO);
-			dest->y = (src->x * s / TRIG_MAX_RATIO) + (src->y * c / TRIG_MAX_RATIO);
-			dest->x += fpath->offset.x + adjust;
-			dest->y += fpath->offset.y + adjust;
-			
-			// grow a bounding box around the points visited.
-			if (dest->x < fctx->min.x) fctx->min.x = dest->x;
-			if (dest->y < fctx->min.y) fctx->min.y = dest->y;
-			if (dest->x > fctx->max.x) fctx->max.x = dest->x;
-			if (dest->y > fctx->max.y) fctx->max.y = dest->y;
-			
-			++src;
-			++dest;
-		}
-		
-		// rasterize the edges into the buffer
-		for (uint32_t k = 0; k < fpath->num_points; ++k) {
-			fpath_plot_edge_bw(fctx, points+k, points+((k+1) % fpath->num_points));
+void fpath_draw_filled16_bw(FContext* fctx, FPath16* fpath) {
+	fpath_draw_filled16_common(fctx, fpath, -FIXED_POINT_SCALE / 2, fpath_plot_edge_bw);
+}
+
+/*
+ * Fill a y-monotone polygon by walking its left and right chains together
+ * and writing the spans between them straight into the target.  The chains
+ * may cross, so each span is ordered before it is drawn.  This covers
+ * exactly the pixels that the edge-flag resolve would.
+ */
+void fpath_fill_monotone_bw(FContext* fctx, FPoint* points, uint32_t num_points) {
+
+	uint32_t top, bottom;
+	fpath_find_extents(points, num_points, &top, &bottom);
+
+	Chain left, right;
+	chain_init(&left, points, num_points, top, bottom, 1);
+	chain_init(&right, points, num_points, top, bottom, num_points - 1);
+	STAT_ADD(fctx, edgesSetUp, num_points);
+
+	Target t;
+	if (!fpath_capture_target(fctx, &t)) {
+		return;
+	}
+	uint8_t color = fpath_fill_byte(fctx, &t);
+
+	while (chain_advance(&left, &edge_init) && chain_advance(&right, &edge_init)) {
+		int32_t rows = left.edge.height < right.edge.height ? left.edge.height : right.edge.height;
+		STAT_ADD(fctx, rowsPlotted, 2 * rows);
+		while (rows--) {
+			if (left.edge.x < right.edge.x) {
+				fpath_span(&t, left.edge.y, left.edge.x, right.edge.x, color);
+			} else {
+				fpath_span(&t, left.edge.y, right.edge.x, left.edge.x, color);
+			}
+			edge_step(&left.edge);
+			edge_step(&right.edge);
 		}
-		
-		free(points);
 	}
 
+	fpath_release_target(fctx, &t);
 }
 
 void fpath_end_fill_bw(FContext* fctx) {
 	
-#ifdef PBL_COLOR
-	uint8_t color = fctx->fillColor.argb;
-#else
-	uint8_t color = gcolor_equal(fctx->fillColor, GColorWhite) ? 0xff : 0x00;
-#endif
+	if (fctx->pendingPoints) {
+		STAT_TIME_BEGIN(resolve);
+		fpath_fill_monotone_bw(fctx, fctx->points, fctx->pendingPoints);
+		STAT_TIME_END(fctx, resolve);
+		fctx->pendingPoints = 0;
+		return;
+	}
+	if (!fctx->flagsDirty) {
+		return;
+	}
+	STAT_TIME_BEGIN(resolve);
 
-	uint16_t rowBegin = FIXED_TO_INT(fctx->min.y);
-	uint16_t rowEnd   = FIXED_TO_INT(fctx->max.y) + 1;
-	uint16_t colBegin = FIXED_TO_INT(fctx->min.x);
-	uint16_t colEnd   = FIXED_TO_INT(fctx->max.x) + 1;
+	GRect flags = gbitmap_get_bounds(fctx->flagBuffer);
+	int32_t rowBegin = fpath_clamp(FIXED_TO_INT(fctx->min.y), 0, flags.size.h);
+	int32_t rowEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.y) + 1, 0, flags.size.h);
+	int32_t colBegin = fpath_clamp(FIXED_TO_INT(fctx->min.x), 0, flags.size.w - 1);
+	int32_t colEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.x) + 1, 0, flags.size.w - 1);
 	
-	GBitmap* fb = graphics_capture_frame_buffer(fctx->gctx);
-	uint8_t* fbData = gbitmap_get_data(fb);
-	uint16_t fbStride = gbitmap_get_bytes_per_row(fb);
+	Target t;
+	if (!fpath_capture_target(fctx, &t)) {
+		return;
+	}
+	uint8_t color = fpath_fill_byte(fctx, &t);
 	
 	uint8_t* data = gbitmap_get_data(fctx->flagBuffer);
 	uint16_t stride = gbitmap_get_bytes_per_row(fctx->flagBuffer);
 	
-	uint8_t* dest;
 	uint8_t* src;
 	uint8_t mask;
-	uint16_t col, row;
+	int32_t col, row;
 	
+	// each pair of flags on a row delimits a span of inside pixels.
 	for (row = rowBegin; row < rowEnd; ++row) {
 
+#if FPATH_SWAR
+		if (t.bw) {
+			fpath_resolve_row_bw(&t, data + stride * row, row, colBegin, colEnd, color);
+			continue;
+		}
+#endif
 		bool inside = false;
+		int32_t spanBegin = colBegin;
 		for (col = colBegin; col <= colEnd; ++col) {
 			
-#ifdef PBL_COLOR
-			dest = fbData + fbStride * row + col;
-#else
-			dest = fbData + fbStride * row + col / 8;
+#if FPATH_SWAR
+			// a byte without flags leaves the span as it is.
+			if ((col & 7) == 0 && col + 7 <= colEnd && data[stride * row + col / 8] == 0) {
+				col += 7;
+				continue;
+			}
 #endif
 			src = data + stride * row + col / 8;
 			mask = 1 << (col % 8);
 			if (*src & mask) {
 				inside = !inside;
+				if (inside) {
+					spanBegin = col;
+				} else {
+					fpath_span(&t, row, spanBegin, col, color);
+				}
 			}
 			*src &= ~mask;
-			if (inside) {
-#ifdef PBL_COLOR
-				*dest = color;
-#else
-				*dest = (color & mask) | (*dest & ~mask);
+		}
+		if (inside) {
+			fpath_span(&t, row, spanBegin, colEnd + 1, color);
+		}
+	}
+	STAT_ADD(fctx, pixelsResolved, (rowEnd - rowBegin) * (colEnd - colBegin + 1));
+	
+	fpath_release_target(fctx, &t);
+	fctx->flagsDirty = false;
+	STAT_TIME_END(fctx, resolve);
+
+}
+
+/*
+ * Resolve the flag buffer into a 1 bit-per-pixel coverage mask instead of
+ * the target, at most max_rows rows per call.  The first call clears the
+ * mask; anything outside of it is discarded (but its flags are still
+ * cleared).  Returns true once the whole fill has been resolved.
+ */
+bool fpath_end_fill_mask_step_bw(FContext* fctx, GBitmap* coverage, uint16_t max_rows) {
+
+	uint8_t* maskData = gbitmap_get_data(coverage);
+	uint16_t maskStride = gbitmap_get_bytes_per_row(coverage);
+	GRect maskBounds = gbitmap_get_bounds(coverage);
+
+	GRect flags = gbitmap_get_bounds(fctx->flagBuffer);
+	int32_t rowBegin = fpath_clamp(FIXED_TO_INT(fctx->min.y), 0, flags.size.h);
+	int32_t rowEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.y) + 1, 0, flags.size.h);
+	int32_t colBegin = fpath_clamp(FIXED_TO_INT(fctx->min.x), 0, flags.size.w - 1);
+	int32_t colEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.x) + 1, 0, flags.size.w - 1);
+
+	if (fctx->resolveRow < 0) {
+		fpath_flush_pending(fctx, fctx->renderer->plot_edge);
+		memset(maskData, 0, maskStride * maskBounds.size.h);
+		fctx->resolveRow = rowBegin;
+	}
+	if (!fctx->flagsDirty) {
+		return true;
+	}
+	if (rowEnd - fctx->resolveRow > max_rows) {
+		rowEnd = fctx->resolveRow + max_rows;
+	}
+	STAT_TIME_BEGIN(resolve);
+
+	uint8_t* data = gbitmap_get_data(fctx->flagBuffer);
+	uint16_t stride = gbitmap_get_bytes_per_row(fctx->flagBuffer);
+
+	int32_t row;
+
+#if FPATH_SWAR
+	Target m;
+	m.bitmap = coverage;
+	m.data = maskData;
+	m.stride = maskStride;
+	m.width = maskBounds.size.w;
+	m.height = maskBounds.size.h;
+	m.bw = true;
 #endif
+
+	for (row = fctx->resolveRow; row < rowEnd; ++row) {
+
+#if FPATH_SWAR
+		fpath_resolve_row_bw(&m, data + stride * row, row, colBegin, colEnd, 0xff);
+#else
+		bool visible = row < maskBounds.size.h;
+		bool inside = false;
+		for (int32_t col = colBegin; col <= colEnd; ++col) {
+			uint8_t* src = data + stride * row + col / 8;
+			uint8_t mask = 1 << (col % 8);
+			if (*src & mask) {
+				inside = !inside;
+			}
+			*src &= ~mask;
+			if (inside && visible && col < maskBounds.size.w) {
+				maskData[maskStride * row + col / 8] |= mask;
 			}
 		}
+#endif
 	}
-	
-	graphics_release_frame_buffer(fctx->gctx, fb);
+	STAT_ADD(fctx, pixelsResolved, (rowEnd - fctx->resolveRow) * (colEnd - colBegin + 1));
+	STAT_TIME_END(fctx, resolve);
+
+	fctx->resolveRow = rowEnd;
+	if (rowEnd < fpath_clamp(FIXED_TO_INT(fctx->max.y) + 1, 0, flags.size.h)) {
+		return false;
+	}
+	fctx->flagsDirty = false;
+	return true;
+}
 
+void fpath_end_fill_mask_bw(FContext* fctx, GBitmap* coverage) {
+	fpath_end_fill_mask_step_bw(fctx, coverage, UINT16_MAX);
 }
 
-void fpath_deinit_context_bw(FContext* fctx) {
-	if (fctx->gctx) {
-		gbitmap_destroy(fctx->flagBuffer);
-		fctx->gctx = NULL;
+/*
+ * Stamp a 1 bit-per-pixel coverage mask into the target with its top left
+ * corner at origin, painting the covered pixels in the fill color.
+ */
+void fpath_draw_mask_bw(FContext* fctx, GBitmap* coverage, GPoint origin) {
+
+	uint8_t* maskData = gbitmap_get_data(coverage);
+	uint16_t maskStride = gbitmap_get_bytes_per_row(coverage);
+	GRect maskBounds = gbitmap_get_bounds(coverage);
+
+	Target t;
+	if (!fpath_capture_target(fctx, &t)) {
+		return;
+	}
+	uint8_t color = fpath_fill_byte(fctx, &t);
+
+	int32_t rowBegin = origin.y < 0 ? -origin.y : 0;
+	int32_t rowEnd = maskBounds.size.h;
+	if (origin.y + rowEnd > t.height) rowEnd = t.height - origin.y;
+
+	if (!t.bw) {
+		int32_t colBegin = origin.x < 0 ? -origin.x : 0;
+		int32_t colEnd = maskBounds.size.w;
+		if (origin.x + colEnd > t.width) colEnd = t.width - origin.x;
+
+		for (int32_t row = rowBegin; row < rowEnd; ++row) {
+			uint8_t* src = maskData + maskStride * row;
+			uint8_t* dest = t.data + t.stride * (origin.y + row) + origin.x;
+			for (int32_t col = colBegin; col < colEnd; ++col) {
+				// skip empty bytes of the mask a whole byte at a time.
+				if ((col % 8) == 0 && src[col / 8] == 0) {
+					col += 7;
+					continue;
+				}
+				if (src[col / 8] & (1 << (col % 8))) {
+					dest[col] = color;
+					STAT_WRITTEN(&t, 1);
+				}
+			}
+		}
+	} else {
+		// Each mask byte lands on (at most) two target bytes, shifted left
+		// by the bit offset of origin.x.
+		int32_t shift = origin.x & 7;
+		int32_t byteOffset = (origin.x - shift) / 8;
+		int32_t maskBytes = (maskBounds.size.w + 7) / 8;
+		int32_t targetBytes = (t.width + 7) / 8;
+
+		for (int32_t row = rowBegin; row < rowEnd; ++row) {
+			uint8_t* src = maskData + maskStride * row;
+			uint8_t* dest = t.data + t.stride * (origin.y + row);
+			for (int32_t k = 0; k < maskBytes; ++k) {
+				if (src[k] == 0) continue;
+				STAT_WRITTEN(&t, __builtin_popcount(src[k]));
+				uint16_t bits = (uint16_t)src[k] << shift;
+				int32_t d = byteOffset + k;
+				if (d >= 0 && d < targetBytes) {
+					uint8_t mask = bits & 0xff;
+					dest[d] = (color & mask) | (dest[d] & ~mask);
+				}
+				if (d + 1 >= 0 && d + 1 < targetBytes) {
+					uint8_t mask = bits >> 8;
+					dest[d + 1] = (color & mask) | (dest[d + 1] & ~mask);
+				}
+			}
+		}
 	}
+
+	fpath_release_target(fctx, &t);
 }
 
+const FRenderer fpath_renderer_bw = {
+	.begin_fill = &fpath_begin_fill_bw,
+	.plot_edge = &fpath_plot_edge_bw,
+	.draw_filled = &fpath_draw_filled_bw,
+	.draw_filled16 = &fpath_draw_filled16_bw,
+	.end_fill = &fpath_end_fill_bw,
+	.end_fill_mask = &fpath_end_fill_mask_bw,
+	.end_fill_mask_step = &fpath_end_fill_mask_step_bw,
+	.adjust = -FIXED_POINT_SCALE / 2, // half-pixel offset
+	.aa = false
+};
+
 // --------------------------------------------------------------------------
 // AA - anti-aliased drawing with 8 bit-per-pixel flag buffer.
 // --------------------------------------------------------------------------
@@ -294,6 +1347,12 @@ void fpath_deinit_context_bw(FContext* fctx) {
 #define SUBPIXEL_COUNT 8
 #define SUBPIXEL_SHIFT 3
 
+// The horizontal sample offset of each subpixel row, in 1/8ths of a pixel.
+// Every AA scan converter uses it, so that their results match.
+static const int32_t offsets[SUBPIXEL_COUNT] = {
+	2, 7, 4, 1, 6, 3, 0, 5
+};
+
 #define FIXED_POINT_SHIFT_AA 1
 #define FIXED_POINT_SCALE_AA 2
 #define INT_TO_FIXED_AA(a) ((a) * FIXED_POINT_SCALE)
@@ -353,44 +1412,63 @@ void edge_init_aa(Edge* e, FPoint* top, FPoint* bottom) {
 	}
 }
 
+extern const FRenderer fpath_renderer_aa;
+
 void fpath_init_context_aa(FContext* fctx, GContext* gctx) {
 	
 	GBitmap* frameBuffer = graphics_capture_frame_buffer(gctx);
 	if (frameBuffer) {
 		GRect bounds = gbitmap_get_bounds(frameBuffer);
 		graphics_release_frame_buffer(gctx, frameBuffer);
-		bounds.size.w += 1;
-		bounds.size.h += 1;
+		fpath_init_flags(fctx, bounds.size, GBitmapFormat8Bit);
+		fctx->renderer = &fpath_renderer_aa;
+		fctx->target = NULL;
 		fctx->gctx = gctx;
-		fctx->flagBuffer = gbitmap_create_blank(bounds.size, GBitmapFormat8Bit);
 		fctx->strokeColor = GColorBlack;
 		fctx->fillColor = GColorWhite;
 		fctx->aarampDirty = true;
 	}
 }
 
-void fpath_plot_edge_aa(FContext* fctx, FPoint* a, FPoint* b) {
+void fpath_init_context_bitmap_aa(FContext* fctx, GBitmap* target) {
 
-	static const int32_t offsets[SUBPIXEL_COUNT] = {
-		2, 7, 4, 1, 6, 3, 0, 5 // 1/8ths
-	};
+	GBitmapFormat format = gbitmap_get_format(target);
+	if (format == GBitmapFormat1Bit || format == GBitmapFormat8Bit) {
+		GRect bounds = gbitmap_get_bounds(target);
+		fpath_init_flags(fctx, bounds.size, GBitmapFormat8Bit);
+		fctx->renderer = &fpath_renderer_aa;
+		fctx->target = target;
+		fctx->gctx = NULL;
+		fctx->strokeColor = GColorBlack;
+		fctx->fillColor = GColorWhite;
+		fctx->aarampDirty = true;
+	}
+}
+
+void fpath_plot_edge_aa(FContext* fctx, FPoint* a, FPoint* b) {
 	
-	Edge edge;
-	if (a->y > b->y) {
-		edge_init_aa(&edge, b, a);
-	} else {
-		edge_init_aa(&edge, a, b);
+	FPoint* top = a->y > b->y ? b : a;
+	FPoint* bottom = a->y > b->y ? a : b;
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	if (edge_outside(top, bottom, bounds.size)) {
+		return;
 	}
+	Edge edge;
+	edge_init_aa(&edge, top, bottom);
+	STAT_ADD(fctx, edgesSetUp, 1);
 	
 	uint8_t* data = gbitmap_get_data(fctx->flagBuffer);
 	int16_t stride = gbitmap_get_bytes_per_row(fctx->flagBuffer);
+	edge_clip_rows(&edge, bounds.size.h * SUBPIXEL_COUNT);
+	STAT_ADD(fctx, rowsPlotted, edge.height);
 	int32_t height = edge.height;
-	while (height--) {
+	while (height-- > 0) {
 		int32_t ySub = edge.y & (SUBPIXEL_COUNT - 1);
 		uint8_t mask = 1 << ySub;
 		int32_t pixelX = (edge.x + offsets[ySub]) / SUBPIXEL_COUNT;
 		int32_t pixelY = edge.y / SUBPIXEL_COUNT;
 		
+		pixelX = fpath_clamp(pixelX, 0, bounds.size.w - 1);
 		uint8_t* p = data + pixelY * stride + pixelX;
 		*p ^= mask;
 
@@ -399,45 +1477,64 @@ void fpath_plot_edge_aa(FContext* fctx, FPoint* a, FPoint* b) {
 }
 
 void fpath_draw_filled_aa(FContext* fctx, FPath* fpath) {
-	
-	// allocate buffer for transformed points.
-	FPoint* points = (FPoint*)malloc(fpath->num_points * sizeof(FPoint));
-	if (points) {
-		
-		// offset by half of a subpixel.
-		int32_t adjust = -1;
-		
-		// rotate and translate the points.
-		FPoint* src = fpath->points;
-		FPoint* end = src + fpath->num_points;
-		FPoint* dest = points;
-		int32_t c = cos_lookup(fpath->rotation);
-		int32_t s = sin_lookup(fpath->rotation);
-		while (src != end) {
-			dest->x = (src->x * c / TRIG_MAX_RATIO) - (src->y * s / TRIG_MAX_RATIO);
-			dest->y = (src->x * s / TRIG_MAX_RATIO) + (src->y * c / TRIG_MAX_RATIO);
-			dest->x += fpath->offset.x + adjust;
-			dest->y += fpath->offset.y + adjust;
-			
-			// grow a bounding box around the points visited.
-			if (dest->x < fctx->min.x) fctx->min.x = dest->x;
-			if (dest->y < fctx->min.y) fctx->min.y = dest->y;
-			if (dest->x > fctx->max.x) fctx->max.x = dest->x;
-			if (dest->y > fctx->max.y) fctx->max.y = dest->y;
-			
-			++src;
-			++dest;
-		}
-		
-		// rasterize the edges into the buffer
-		for (uint32_t k = 0; k < fpath->num_points; ++k) {
-			fpath_plot_edge_aa(fctx, points+k, points+((k+1) % fpath->num_points));
-		}
-		
-		free(points);
+	// offset by half of a subpixel.
+	fpath_draw_filled_common(fctx, fpath, -1, fpath_plot_edge_aa);
+}
+
+void fpath_draw_filled16_aa(FContext* fctx, FPath16* fpath) {
+	fpath_draw_filled16_common(fctx, fpath, -1, fpath_plot_edge_aa);
+}
+
+/*
+ * Reduced AA walks only the even subrows of an edge, two at a time, and
+ * flags both subrows of each pair.  Coverage comes in quarters, for half the
+ * edge work, and the flag buffer resolves exactly as for full AA.
+ */
+void fpath_plot_edge_aa_reduced(FContext* fctx, FPoint* a, FPoint* b) {
+
+	FPoint* top = a->y > b->y ? b : a;
+	FPoint* bottom = a->y > b->y ? a : b;
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	if (edge_outside(top, bottom, bounds.size)) {
+		return;
+	}
+	Edge edge;
+	edge_init_aa(&edge, top, bottom);
+	STAT_ADD(fctx, edgesSetUp, 1);
+	if (edge.height > 0 && (edge.y & 1)) {
+		edge_step(&edge);
+	}
+	// the buffer starts on an even subrow, so clipping keeps y even.
+	edge_clip_rows(&edge, bounds.size.h * SUBPIXEL_COUNT);
+	if (edge.height <= 0) {
+		return;
+	}
+	STAT_ADD(fctx, rowsPlotted, (edge.height + 1) / 2);
+
+	uint8_t* data = gbitmap_get_data(fctx->flagBuffer);
+	int16_t stride = gbitmap_get_bytes_per_row(fctx->flagBuffer);
+	while (edge.height > 0) {
+		int32_t ySub = edge.y & (SUBPIXEL_COUNT - 1);
+		uint8_t mask = 3 << ySub;
+		int32_t pixelX = (edge.x + offsets[ySub]) / SUBPIXEL_COUNT;
+		int32_t pixelY = edge.y / SUBPIXEL_COUNT;
+
+		pixelX = fpath_clamp(pixelX, 0, bounds.size.w - 1);
+		uint8_t* p = data + pixelY * stride + pixelX;
+		*p ^= mask;
+
+		edge_step2(&edge);
 	}
 }
 
+void fpath_draw_filled_aa_reduced(FContext* fctx, FPath* fpath) {
+	fpath_draw_filled_common(fctx, fpath, -1, fpath_plot_edge_aa_reduced);
+}
+
+void fpath_draw_filled16_aa_reduced(FContext* fctx, FPath16* fpath) {
+	fpath_draw_filled16_common(fctx, fpath, -1, fpath_plot_edge_aa_reduced);
+}
+
 // count the number of bits set in v
 uint8_t countBits(uint8_t v) {
 	unsigned int c; // c accumulates the total bits set in v
@@ -447,82 +1544,1534 @@ uint8_t countBits(uint8_t v) {
 	return c;
 }
 
-void fpath_end_fill_aa(FContext* fctx) {
+#if FPATH_SIMD
+/*
+ * The vector part of fpath_resolve_row_aa: from col, a register of flags
+ * at a time, while a whole one fits before end.  The running masks are a
+ * prefix XOR across the bytes and their coverage a bytewise popcount, as
+ * in the SWAR loop.  With AVX2 the popcount and the ramp are table
+ * shuffles and the pixels without coverage are blended back, otherwise the
+ * ramp is looked up a byte at a time.  Returns the column to continue from.
+ */
+int32_t fpath_resolve_row_aa_simd(Target* t, const uint8_t* ramp, uint8_t* src, uint8_t* dest,
+                                  int32_t col, int32_t end, uint8_t* mask) {
+
+#if defined(__AVX2__)
+	uint8_t table[16] = {0};
+	memcpy(table, ramp, SUBPIXEL_COUNT + 1);
+	const __m256i ramps = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table));
+	const __m256i nibbleBits = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+	                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const __m256i lastByte = _mm256_set1_epi8(15);
+	const __m256i zero = _mm256_setzero_si256();
+	for (; col + 32 <= end; col += 32) {
+		__m256i flags = _mm256_loadu_si256((const __m256i*)(src + col));
+		if (_mm256_testz_si256(flags, flags)) {
+			if (*mask) {
+				_mm256_storeu_si256((__m256i*)(dest + col), _mm256_set1_epi8((char)ramp[countBits(*mask)]));
+				STAT_WRITTEN(t, 32);
+			}
+			continue;
+		}
+		_mm256_storeu_si256((__m256i*)(src + col), zero);
+
+		// the shifts stay within each half, so the low half's last mask is
+		// carried into the high half separately.
+		flags = _mm256_xor_si256(flags, _mm256_slli_si256(flags, 1));
+		flags = _mm256_xor_si256(flags, _mm256_slli_si256(flags, 2));
+		flags = _mm256_xor_si256(flags, _mm256_slli_si256(flags, 4));
+		flags = _mm256_xor_si256(flags, _mm256_slli_si256(flags, 8));
+		__m256i carry = _mm256_shuffle_epi8(flags, lastByte);
+		flags = _mm256_xor_si256(flags, _mm256_permute2x128_si256(carry, carry, 0x08));
+		__m256i masks = _mm256_xor_si256(flags, _mm256_set1_epi8((char)*mask));
+		*mask = (uint8_t)_mm256_extract_epi8(masks, 31);
+
+		__m256i counts = _mm256_add_epi8(
+		    _mm256_shuffle_epi8(nibbleBits, _mm256_and_si256(masks, nibble)),
+		    _mm256_shuffle_epi8(nibbleBits, _mm256_and_si256(_mm256_srli_epi16(masks, 4), nibble)));
+		__m256i empty = _mm256_cmpeq_epi8(counts, zero);
+		__m256i d = _mm256_loadu_si256((const __m256i*)(dest + col));
+		d = _mm256_blendv_epi8(_mm256_shuffle_epi8(ramps, counts), d, empty);
+		_mm256_storeu_si256((__m256i*)(dest + col), d);
+		STAT_WRITTEN(t, 32 - __builtin_popcount((uint32_t)_mm256_movemask_epi8(empty)));
+	}
+#else
+	const __m128i zero = _mm_setzero_si128();
+	for (; col + 16 <= end; col += 16) {
+		__m128i flags = _mm_loadu_si128((const __m128i*)(src + col));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(flags, zero)) == 0xffff) {
+			if (*mask) {
+				_mm_storeu_si128((__m128i*)(dest + col), _mm_set1_epi8((char)ramp[countBits(*mask)]));
+				STAT_WRITTEN(t, 16);
+			}
+			continue;
+		}
+		_mm_storeu_si128((__m128i*)(src + col), zero);
+
+		flags = _mm_xor_si128(flags, _mm_slli_si128(flags, 1));
+		flags = _mm_xor_si128(flags, _mm_slli_si128(flags, 2));
+		flags = _mm_xor_si128(flags, _mm_slli_si128(flags, 4));
+		flags = _mm_xor_si128(flags, _mm_slli_si128(flags, 8));
+		__m128i masks = _mm_xor_si128(flags, _mm_set1_epi8((char)*mask));
+		*mask = (uint8_t)(_mm_extract_epi16(masks, 7) >> 8);
+
+		__m128i counts = _mm_sub_epi8(masks, _mm_and_si128(_mm_srli_epi16(masks, 1), _mm_set1_epi8(0x55)));
+		counts = _mm_add_epi8(_mm_and_si128(counts, _mm_set1_epi8(0x33)),
+		                      _mm_and_si128(_mm_srli_epi16(counts, 2), _mm_set1_epi8(0x33)));
+		counts = _mm_and_si128(_mm_add_epi8(counts, _mm_srli_epi16(counts, 4)), _mm_set1_epi8(0x0f));
+		uint8_t c[16];
+		_mm_storeu_si128((__m128i*)c, counts);
+		for (int32_t k = 0; k < 16; ++k) {
+			if (c[k]) {
+				dest[col + k] = ramp[c[k]];
+				STAT_WRITTEN(t, 1);
+			}
+		}
+	}
+#endif
+	return col;
+}
+#endif
+
+#if FPATH_DSP
+/*
+ * The ramp bytes for four coverage counts, merged into the target word: a
+ * byte add of 0xff sets the GE flag of each nonzero count, and SEL takes
+ * those bytes from the ramp and the rest from the target.  On the watch
+ * it's one asm statement, as the SDK's compiler has no intrinsics for them
+ * and SEL has to follow the add that set its flags; host builds check the
+ * same steps with the intrinsics in the tools shim.
+ */
+uint32_t fpath_merge_ramp_dsp(const uint8_t* ramp, uint32_t counts, uint32_t target) {
+	uint32_t ramped = ramp[counts & 0xff] | ramp[(counts >> 8) & 0xff] << 8 |
+	                  ramp[(counts >> 16) & 0xff] << 16 | (uint32_t)ramp[counts >> 24] << 24;
+#if defined(__arm__)
+	uint32_t merged, sum;
+	__asm__("uadd8 %1, %2, %3\n\tsel %0, %4, %5"
+	        : "=r"(merged), "=&r"(sum)
+	        : "r"(counts), "r"(0xffffffffu), "r"(ramped), "r"(target)
+	        : "cc");
+	return merged;
+#else
+	__uadd8(counts, 0xffffffffu);
+	return __sel(ramped, target);
+#endif
+}
+#endif
+
+/*
+ * Resolve a row of AA flags, columns col to end, into an 8 bit-per-pixel
+ * target, writing ramp[coverage] for each covered pixel and clearing the
+ * flags.  Four flags are taken at a time: a prefix XOR across the bytes of
+ * the word gives the running masks, and a bytewise popcount their coverage.
+ * Words without flags are skipped, or filled with one store when inside.
+ */
+void fpath_resolve_row_aa(Target* t, const uint8_t* ramp, uint8_t* src, int32_t y,
+                          int32_t col, int32_t end) {
+
+	uint8_t* dest = t->data + t->stride * y;
+	uint8_t mask = 0;
+
+#if FPATH_SIMD
+	col = fpath_resolve_row_aa_simd(t, ramp, src, dest, col, end, &mask);
+#endif
+#if FPATH_SWAR
+	static const uint32_t zero = 0;
+	for (; col < end && ((uintptr_t)(src + col) & 3); ++col) {
+		mask ^= src[col];
+		src[col] = 0;
+		if (mask) {
+			dest[col] = ramp[countBits(mask)];
+			STAT_WRITTEN(t, 1);
+		}
+	}
+	for (; col + 4 <= end; col += 4) {
+		uint32_t flags;
+		memcpy(&flags, src + col, 4);
+		if (!flags) {
+			if (mask) {
+				uint32_t fill = ramp[countBits(mask)] * 0x01010101u;
+				memcpy(dest + col, &fill, 4);
+				STAT_WRITTEN(t, 4);
+			}
+			continue;
+		}
+		memcpy(src + col, &zero, 4);
+
+		flags ^= flags << 8;
+		flags ^= flags << 16;
+		uint32_t masks = flags ^ (mask * 0x01010101u);
+		mask = masks >> 24;
+
+		uint32_t counts = masks - ((masks >> 1) & 0x55555555u);
+		counts = (counts & 0x33333333u) + ((counts >> 2) & 0x33333333u);
+		counts = (counts + (counts >> 4)) & 0x0f0f0f0fu;
+#if FPATH_DSP
+		uint32_t pixels;
+		memcpy(&pixels, dest + col, 4);
+		pixels = fpath_merge_ramp_dsp(ramp, counts, pixels);
+		memcpy(dest + col, &pixels, 4);
+		STAT_WRITTEN(t, !!(counts & 0xff) + !!(counts & 0xff00) + !!(counts & 0xff0000) + !!(counts >> 24));
+#else
+		for (int32_t k = 0; k < 4; ++k, counts >>= 8) {
+			if (counts & 0xff) {
+				dest[col + k] = ramp[counts & 0xff];
+				STAT_WRITTEN(t, 1);
+			}
+		}
+#endif
+	}
+#endif
+	for (; col < end; ++col) {
+		mask ^= src[col];
+		src[col] = 0;
+		if (mask) {
+			dest[col] = ramp[countBits(mask)];
+			STAT_WRITTEN(t, 1);
+		}
+	}
+}
+
+/*
+ * The target byte for a pixel with the given subpixel coverage.  1 bit-per-
+ * pixel targets can't blend, so they take the fill color from half coverage
+ * up and the stroke color below that.
+ */
+uint8_t fpath_ramp_byte(FContext* fctx, Target* t, uint8_t coverage) {
+	if (t->bw) {
+		GColor c = coverage * 2 >= SUBPIXEL_COUNT ? fctx->fillColor : fctx->strokeColor;
+		return gcolor_equal(c, GColorWhite) ? 0xff : 0x00;
+	}
+	return fctx->aaramp[coverage].argb;
+}
+
+/*
+ * Resolve one pixel row of a y-monotone fill.  Each of the count sampled
+ * subpixel rows covers the pixels [lefts[k], rights[k]), and stands for
+ * weight subpixel rows.  Pixels between the right-most left end and the
+ * left-most right end are covered by all of them, so coverage only has to
+ * be counted near the two ends of the span.
+ */
+void fpath_span_aa(FContext* fctx, Target* t, int32_t y,
+                   int32_t* lefts, int32_t* rights, uint8_t count, uint8_t weight) {
+
+	int32_t begin = lefts[0], innerBegin = lefts[0];
+	int32_t end = rights[0], innerEnd = rights[0];
+	for (uint8_t k = 1; k < count; ++k) {
+		if (lefts[k] < begin) begin = lefts[k];
+		if (lefts[k] > innerBegin) innerBegin = lefts[k];
+		if (rights[k] > end) end = rights[k];
+		if (rights[k] < innerEnd) innerEnd = rights[k];
+	}
+	if (begin < 0) begin = 0;
+	if (end > t->width) end = t->width;
+
+	uint8_t* row = t->data + t->stride * y;
+	for (int32_t x = begin; x < end; ++x) {
+		if (x == innerBegin && innerBegin < innerEnd) {
+			int32_t innerStop = innerEnd < end ? innerEnd : end;
+			fpath_span(t, y, x, innerStop, fpath_ramp_byte(fctx, t, count * weight));
+			x = innerStop - 1;
+			continue;
+		}
+		uint8_t coverage = 0;
+		for (uint8_t k = 0; k < count; ++k) {
+			if (lefts[k] <= x && x < rights[k]) coverage += weight;
+		}
+		if (coverage > 0) {
+			fpath_put(t, row, x, fpath_ramp_byte(fctx, t, coverage));
+		}
+	}
+}
+
+/*
+ * Anti-aliased counterpart to fpath_fill_monotone_bw.  The chains are walked
+ * in subpixel rows, with each row's end points snapped to pixels through the
+ * same offsets pattern that fpath_plot_edge_aa uses, so the result matches
+ * the edge-flag resolve.  With a weight of 2 only the even subrows are
+ * sampled, two rows a step, to match fpath_plot_edge_aa_reduced.
+ */
+void fpath_fill_monotone_aa(FContext* fctx, FPoint* points, uint32_t num_points, uint8_t weight) {
+
+	uint32_t top, bottom;
+	fpath_find_extents(points, num_points, &top, &bottom);
+
+	Chain left, right;
+	chain_init(&left, points, num_points, top, bottom, 1);
+	chain_init(&right, points, num_points, top, bottom, num_points - 1);
+	STAT_ADD(fctx, edgesSetUp, num_points);
+
+	Target t;
+	if (!fpath_capture_target(fctx, &t)) {
+		return;
+	}
+
+	int32_t lefts[SUBPIXEL_COUNT];
+	int32_t rights[SUBPIXEL_COUNT];
+	uint8_t count = 0;
+	int32_t pixelY = -1;
+
+	while (chain_advance(&left, &edge_init_aa) && chain_advance(&right, &edge_init_aa)) {
+		int32_t rows = left.edge.height < right.edge.height ? left.edge.height : right.edge.height;
+		while (rows > 0) {
+			int32_t y = left.edge.y;
+			bool sampled = weight == 1 || !(y & 1);
+			STAT_ADD(fctx, rowsPlotted, sampled ? 2 : 0);
+			if (sampled && y >= 0 && y / SUBPIXEL_COUNT < t.height) {
+				if (y / SUBPIXEL_COUNT != pixelY) {
+					if (count) {
+						fpath_span_aa(fctx, &t, pixelY, lefts, rights, count, weight);
+					}
+					pixelY = y / SUBPIXEL_COUNT;
+					count = 0;
+				}
+				int32_t offset = offsets[y & (SUBPIXEL_COUNT - 1)];
+				int32_t x0 = (left.edge.x + offset) / SUBPIXEL_COUNT;
+				int32_t x1 = (right.edge.x + offset) / SUBPIXEL_COUNT;
+				if (x0 < x1) {
+					lefts[count] = x0;
+					rights[count] = x1;
+					++count;
+				} else if (x1 < x0) {
+					lefts[count] = x1;
+					rights[count] = x0;
+					++count;
+				}
+			}
+			if (sampled && weight == 2 && rows >= 2) {
+				edge_step2(&left.edge);
+				edge_step2(&right.edge);
+				rows -= 2;
+			} else {
+				edge_step(&left.edge);
+				edge_step(&right.edge);
+				--rows;
+			}
+		}
+	}
+	if (count) {
+		fpath_span_aa(fctx, &t, pixelY, lefts, rights, count, weight);
+	}
+
+	fpath_release_target(fctx, &t);
+}
+
+// weight is 1 for full AA, 2 for reduced AA; see fpath_fill_monotone_aa.
+void fpath_end_fill_aa_common(FContext* fctx, uint8_t weight) {
 	
 	if (fctx->aarampDirty) {
 		fpath_calc_ramp_aa(fctx);
 	}
+
+	if (fctx->pendingPoints) {
+		STAT_TIME_BEGIN(resolve);
+		fpath_fill_monotone_aa(fctx, fctx->points, fctx->pendingPoints, weight);
+		STAT_TIME_END(fctx, resolve);
+		fctx->pendingPoints = 0;
+		return;
+	}
+	if (!fctx->flagsDirty) {
+		return;
+	}
+	STAT_TIME_BEGIN(resolve);
 	
-	uint16_t rowBegin = FIXED_TO_INT(fctx->min.y);
-	uint16_t rowEnd   = FIXED_TO_INT(fctx->max.y) + 2;
-	uint16_t colBegin = FIXED_TO_INT(fctx->min.x);
-	uint16_t colEnd   = FIXED_TO_INT(fctx->max.x) + 2;
+	GRect flags = gbitmap_get_bounds(fctx->flagBuffer);
+	int32_t rowBegin = fpath_clamp(FIXED_TO_INT(fctx->min.y), 0, flags.size.h);
+	int32_t rowEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.y) + 2, 0, flags.size.h);
+	int32_t colBegin = fpath_clamp(FIXED_TO_INT(fctx->min.x), 0, flags.size.w);
+	int32_t colEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.x) + 2, 0, flags.size.w);
 	
-	GBitmap* fb = graphics_capture_frame_buffer(fctx->gctx);
-	uint8_t* fbData = gbitmap_get_data(fb);
-	uint16_t fbStride = gbitmap_get_bytes_per_row(fb);
-	uint16_t fbStep = fbStride - (colEnd - colBegin);
+	Target t;
+	if (!fpath_capture_target(fctx, &t)) {
+		return;
+	}
 	
 	uint8_t* data = gbitmap_get_data(fctx->flagBuffer);
 	uint16_t stride = gbitmap_get_bytes_per_row(fctx->flagBuffer);
-	uint16_t step = stride - (colEnd - colBegin);
 	
-	uint8_t* dest = fbData + rowBegin * fbStride + colBegin;
-	uint8_t* src = data + rowBegin * stride + colBegin;
-	uint16_t col, row;
+	// the flag buffer is a pixel larger than the target, the extra column
+	// and row only need clearing.
+	int32_t visibleEnd = colEnd < t.width ? colEnd : t.width;
+	int32_t col, row;
 	
-	for (row = rowBegin; row < rowEnd; ++row, dest += fbStep, src += step) {
-		uint8_t mask = 0;
-		for (col = colBegin; col < colEnd; ++col, ++dest, ++src) {
+	for (row = rowBegin; row < rowEnd; ++row) {
+		uint8_t* src = data + row * stride;
+		uint8_t* dest = t.data + row * t.stride;
+		if (row >= t.height) {
+			memset(src + colBegin, 0, colEnd - colBegin);
+			continue;
+		}
+		if (!t.bw) {
+			fpath_resolve_row_aa(&t, (const uint8_t*)fctx->aaramp, src, row, colBegin, visibleEnd);
+			col = visibleEnd > colBegin ? visibleEnd : colBegin;
+		} else {
+			uint8_t mask = 0;
+			for (col = colBegin; col < visibleEnd; ++col) {
 
-			mask ^= *src;
-			*src = 0;
-			uint8_t coverage = countBits(mask);
-			
-			if (coverage >  0) {
-				*dest = fctx->aaramp[coverage].argb;
+				mask ^= src[col];
+				src[col] = 0;
+				uint8_t coverage = countBits(mask);
+				
+				if (coverage >  0) {
+					fpath_put(&t, dest, col, fpath_ramp_byte(fctx, &t, coverage));
+				}
 			}
 		}
+		for (; col < colEnd; ++col) {
+			src[col] = 0;
+		}
 	}
+	STAT_ADD(fctx, pixelsResolved, (rowEnd - rowBegin) * (colEnd - colBegin));
 	
-	graphics_release_frame_buffer(fctx->gctx, fb);
+	fpath_release_target(fctx, &t);
+	fctx->flagsDirty = false;
+	STAT_TIME_END(fctx, resolve);
 
 }
 
-// Initialize for Anti-Aliased rendering.
-fpath_init_context_func   fpath_init_context   = &fpath_init_context_aa;
-fpath_begin_fill_func     fpath_begin_fill     = &fpath_begin_fill_bw;     // note bw
-fpath_draw_filled_func    fpath_draw_filled    = &fpath_draw_filled_aa;
-fpath_end_fill_func       fpath_end_fill       = &fpath_end_fill_aa;
-fpath_deinit_context_func fpath_deinit_context = &fpath_deinit_context_bw; // note bw
-
-void fpath_enable_aa(bool enable) {
-	if (enable) {
-		fpath_init_context   = &fpath_init_context_aa;
-		fpath_begin_fill     = &fpath_begin_fill_bw;     // note bw
-		fpath_draw_filled    = &fpath_draw_filled_aa;
-		fpath_end_fill       = &fpath_end_fill_aa;
-		fpath_deinit_context = &fpath_deinit_context_bw; // note bw
-	} else {
-		fpath_init_context   = &fpath_init_context_bw;
-		fpath_begin_fill     = &fpath_begin_fill_bw;
-		fpath_draw_filled    = &fpath_draw_filled_bw;
-		fpath_end_fill       = &fpath_end_fill_bw;
-		fpath_deinit_context = &fpath_deinit_context_bw;
-	}
+void fpath_end_fill_aa(FContext* fctx) {
+	fpath_end_fill_aa_common(fctx, 1);
 }
 
-bool fpath_is_aa_enabled() {
-	return fpath_init_context == &fpath_init_context_aa;
+void fpath_end_fill_aa_reduced(FContext* fctx) {
+	fpath_end_fill_aa_common(fctx, 2);
 }
 
-#else
+/*
+ * Resolve the flag buffer into an 8 bit-per-pixel coverage mask, one byte
+ * per pixel holding the number of covered subpixels (0 to SUBPIXEL_COUNT),
+ * at most max_rows rows per call.
+ */
+bool fpath_end_fill_mask_step_aa(FContext* fctx, GBitmap* coverage, uint16_t max_rows) {
 
-// Initialize for Black & White rendering.
-fpath_init_context_func   fpath_init_context   = &fpath_init_context_bw;
-fpath_begin_fill_func     fpath_begin_fill     = &fpath_begin_fill_bw;
-fpath_draw_filled_func    fpath_draw_filled    = &fpath_draw_filled_bw;
-fpath_end_fill_func       fpath_end_fill       = &fpath_end_fill_bw;
-fpath_deinit_context_func fpath_deinit_context = &fpath_deinit_context_bw;
+	uint8_t* maskData = gbitmap_get_data(coverage);
+	uint16_t maskStride = gbitmap_get_bytes_per_row(coverage);
+	GRect maskBounds = gbitmap_get_bounds(coverage);
 
-#endif
+	GRect flags = gbitmap_get_bounds(fctx->flagBuffer);
+	int32_t rowBegin = fpath_clamp(FIXED_TO_INT(fctx->min.y), 0, flags.size.h);
+	int32_t rowEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.y) + 2, 0, flags.size.h);
+	int32_t colBegin = fpath_clamp(FIXED_TO_INT(fctx->min.x), 0, flags.size.w);
+	int32_t colEnd   = fpath_clamp(FIXED_TO_INT(fctx->max.x) + 2, 0, flags.size.w);
+
+	if (fctx->resolveRow < 0) {
+		fpath_flush_pending(fctx, fctx->renderer->plot_edge);
+		memset(maskData, 0, maskStride * maskBounds.size.h);
+		fctx->resolveRow = rowBegin;
+	}
+	if (!fctx->flagsDirty) {
+		return true;
+	}
+	if (rowEnd - fctx->resolveRow > max_rows) {
+		rowEnd = fctx->resolveRow + max_rows;
+	}
+	STAT_TIME_BEGIN(resolve);
+
+	uint8_t* data = gbitmap_get_data(fctx->flagBuffer);
+	uint16_t stride = gbitmap_get_bytes_per_row(fctx->flagBuffer);
+	int32_t col, row;
+
+#if FPATH_SWAR
+	static const uint8_t counts[SUBPIXEL_COUNT + 1] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+	Target m;
+	m.bitmap = coverage;
+	m.data = maskData;
+	m.stride = maskStride;
+	m.width = maskBounds.size.w;
+	m.height = maskBounds.size.h;
+	m.bw = false;
+	int32_t visibleEnd = colEnd < m.width ? colEnd : m.width;
+#endif
+
+	for (row = fctx->resolveRow; row < rowEnd; ++row) {
+		uint8_t* src = data + row * stride;
+#if FPATH_SWAR
+		col = colBegin;
+		if (row < m.height && visibleEnd > colBegin) {
+			fpath_resolve_row_aa(&m, counts, src, row, colBegin, visibleEnd);
+			col = visibleEnd;
+		}
+		for (; col < colEnd; ++col) {
+			src[col] = 0;
+		}
+#else
+		uint8_t* dest = maskData + row * maskStride;
+		bool visible = row < maskBounds.size.h;
+		uint8_t mask = 0;
+		for (col = colBegin; col < colEnd; ++col) {
+			mask ^= src[col];
+			src[col] = 0;
+			if (mask && visible && col < maskBounds.size.w) {
+				dest[col] = countBits(mask);
+			}
+		}
+#endif
+	}
+	STAT_ADD(fctx, pixelsResolved, (rowEnd - fctx->resolveRow) * (colEnd - colBegin));
+	STAT_TIME_END(fctx, resolve);
+
+	fctx->resolveRow = rowEnd;
+	if (rowEnd < fpath_clamp(FIXED_TO_INT(fctx->max.y) + 2, 0, flags.size.h)) {
+		return false;
+	}
+	fctx->flagsDirty = false;
+	return true;
+}
+
+void fpath_end_fill_mask_aa(FContext* fctx, GBitmap* coverage) {
+	fpath_end_fill_mask_step_aa(fctx, coverage, UINT16_MAX);
+}
+
+/*
+ * Stamp an 8 bit-per-pixel coverage mask into the target with its top left
+ * corner at origin, colorizing it through the anti-aliasing ramp.
+ */
+void fpath_draw_mask_aa(FContext* fctx, GBitmap* coverage, GPoint origin) {
+
+	if (fctx->aarampDirty) {
+		fpath_calc_ramp_aa(fctx);
+	}
+
+	uint8_t* maskData = gbitmap_get_data(coverage);
+	uint16_t maskStride = gbitmap_get_bytes_per_row(coverage);
+	GRect maskBounds = gbitmap_get_bounds(coverage);
+
+	Target t;
+	if (!fpath_capture_target(fctx, &t)) {
+		return;
+	}
+
+	int32_t rowBegin = origin.y < 0 ? -origin.y : 0;
+	int32_t rowEnd = maskBounds.size.h;
+	if (origin.y + rowEnd > t.height) rowEnd = t.height - origin.y;
+	int32_t colBegin = origin.x < 0 ? -origin.x : 0;
+	int32_t colEnd = maskBounds.size.w;
+	if (origin.x + colEnd > t.width) colEnd = t.width - origin.x;
+
+	for (int32_t row = rowBegin; row < rowEnd; ++row) {
+		uint8_t* src = maskData + maskStride * row;
+		uint8_t* dest = t.data + t.stride * (origin.y + row);
+		for (int32_t col = colBegin; col < colEnd; ++col) {
+			if (src[col]) {
+				fpath_put(&t, dest, origin.x + col, fpath_ramp_byte(fctx, &t, src[col]));
+			}
+		}
+	}
+
+	fpath_release_target(fctx, &t);
+}
+
+const FRenderer fpath_renderer_aa = {
+	.begin_fill = &fpath_begin_fill_bw, // note bw
+	.plot_edge = &fpath_plot_edge_aa,
+	.draw_filled = &fpath_draw_filled_aa,
+	.draw_filled16 = &fpath_draw_filled16_aa,
+	.end_fill = &fpath_end_fill_aa,
+	.end_fill_mask = &fpath_end_fill_mask_aa,
+	.end_fill_mask_step = &fpath_end_fill_mask_step_aa,
+	.adjust = -1, // half of a subpixel
+	.aa = true
+};
+
+// contexts only get this one through fpath_set_quality.
+const FRenderer fpath_renderer_aa_reduced = {
+	.begin_fill = &fpath_begin_fill_bw,
+	.plot_edge = &fpath_plot_edge_aa_reduced,
+	.draw_filled = &fpath_draw_filled_aa_reduced,
+	.draw_filled16 = &fpath_draw_filled16_aa_reduced,
+	.end_fill = &fpath_end_fill_aa_reduced,
+	.end_fill_mask = &fpath_end_fill_mask_aa,
+	.end_fill_mask_step = &fpath_end_fill_mask_step_aa,
+	.adjust = -1, // half of a subpixel
+	.aa = true
+};
+
+// Initialize for Anti-Aliased rendering by default.
+static bool aaEnabled = true;
+
+void fpath_enable_aa(bool enable) {
+	aaEnabled = enable;
+}
+
+bool fpath_is_aa_enabled() {
+	return aaEnabled;
+}
+
+void fpath_init_context(FContext* fctx, GContext* gctx) {
+	if (aaEnabled) {
+		fpath_init_context_aa(fctx, gctx);
+	} else {
+		fpath_init_context_bw(fctx, gctx);
+	}
+}
+
+void fpath_init_context_bitmap(FContext* fctx, GBitmap* target) {
+	if (aaEnabled) {
+		fpath_init_context_bitmap_aa(fctx, target);
+	} else {
+		fpath_init_context_bitmap_bw(fctx, target);
+	}
+}
+
+#else
+
+// Initialize for Black & White rendering.
+void fpath_init_context(FContext* fctx, GContext* gctx) {
+	fpath_init_context_bw(fctx, gctx);
+}
+
+void fpath_init_context_bitmap(FContext* fctx, GBitmap* target) {
+	fpath_init_context_bitmap_bw(fctx, target);
+}
+
+#endif
+
+// --------------------------------------------------------------------------
+// Dispatch through the renderer of each context.
+// --------------------------------------------------------------------------
+
+void fpath_begin_fill(FContext* fctx) {
+	fctx->renderer->begin_fill(fctx);
+}
+
+void fpath_draw_filled(FContext* fctx, FPath* fpath) {
+	fctx->renderer->draw_filled(fctx, fpath);
+}
+
+void fpath_draw_filled16(FContext* fctx, FPath16* fpath) {
+	fctx->renderer->draw_filled16(fctx, fpath);
+}
+
+void fpath_end_fill(FContext* fctx) {
+	fpath_add_drawn(fctx, fpath_pixel_bounds(fctx->min, fctx->max));
+	fctx->renderer->end_fill(fctx);
+}
+
+void fpath_end_fill_mask(FContext* fctx, GBitmap* coverage) {
+	fctx->renderer->end_fill_mask(fctx, coverage);
+}
+
+bool fpath_end_fill_mask_step(FContext* fctx, GBitmap* coverage, uint16_t max_rows) {
+	return fctx->renderer->end_fill_mask_step(fctx, coverage, max_rows);
+}
+
+bool fpath_is_context_aa(FContext* fctx) {
+	return fctx->renderer->aa;
+}
+
+void fpath_deinit_context(FContext* fctx) {
+	if (fctx->flagBuffer) {
+		// an unfinished fill must not leave flags behind for the other users.
+		if (fctx->flagsDirty) {
+			GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+			memset(gbitmap_get_data(fctx->flagBuffer), 0,
+			       gbitmap_get_bytes_per_row(fctx->flagBuffer) * bounds.size.h);
+			fctx->flagsDirty = false;
+		}
+		fpath_release_flags(fctx->flagBuffer, !fctx->privateFlags);
+		free(fctx->points);
+		fctx->flagBuffer = NULL;
+		fctx->points = NULL;
+		fctx->pointsCapacity = 0;
+#ifdef PBL_COLOR
+		free(fctx->cells);
+		fctx->cells = NULL;
+		fctx->cellsCapacity = 0;
+#endif
+		fctx->pendingPoints = 0;
+		fctx->target = NULL;
+		fctx->gctx = NULL;
+		STAT_HEAP(fctx);
+	}
+}
+
+#ifdef PBL_COLOR
+// --------------------------------------------------------------------------
+// Quality governor - trades anti-aliasing for frame time.
+// --------------------------------------------------------------------------
+
+FQuality fpath_get_quality(FContext* fctx) {
+	if (fctx->renderer == &fpath_renderer_aa) {
+		return FQualityAA;
+	}
+	if (fctx->renderer == &fpath_renderer_aa_reduced) {
+		return FQualityReducedAA;
+	}
+	return FQualityBW;
+}
+
+bool fpath_set_quality(FContext* fctx, FQuality quality) {
+	static const FRenderer* const renderers[] = {
+		&fpath_renderer_bw, &fpath_renderer_aa_reduced, &fpath_renderer_aa
+	};
+	if (!fctx->flagBuffer || fctx->flagsDirty || fctx->pendingPoints) {
+		return false;
+	}
+	// BW flags are a bit per pixel, so the flag buffer is swapped for one of
+	// the same size in the other format.
+	GBitmapFormat format = FQualityBW == quality ? GBitmapFormat1Bit : GBitmapFormat8Bit;
+	if (gbitmap_get_format(fctx->flagBuffer) != format) {
+		GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+		GBitmap* flags = fpath_acquire_flags(bounds.size, format, !fctx->privateFlags);
+		if (!flags) {
+			return false;
+		}
+		fpath_release_flags(fctx->flagBuffer, !fctx->privateFlags);
+		fctx->flagBuffer = flags;
+		STAT_HEAP(fctx);
+	}
+	fctx->renderer = renderers[quality];
+	return true;
+}
+
+void fpath_reset_governor(FGovernor* g) {
+	g->overruns = 0;
+	g->underruns = 0;
+	g->settle = FPATH_GOVERNOR_SETTLE;
+	g->sinceStepUp = UINT8_MAX;
+}
+
+void fpath_set_frame_budget(FContext* fctx, uint16_t budget_ms) {
+	fctx->governor.budgetMs = budget_ms;
+	fpath_reset_governor(&fctx->governor);
+}
+
+void fpath_begin_frame(FContext* fctx) {
+	fctx->governor.frameBegin = fpath_now_ms();
+}
+
+bool fpath_end_frame(FContext* fctx, bool animating) {
+	FGovernor* g = &fctx->governor;
+	g->frameMs = fpath_now_ms() - g->frameBegin;
+	if (!g->budgetMs) {
+		return false;
+	}
+
+	FQuality quality = fpath_get_quality(fctx);
+	if (!animating) {
+		fpath_reset_governor(g);
+		return quality != FQualityAA && fpath_set_quality(fctx, FQualityAA);
+	}
+
+	if (g->sinceStepUp < UINT8_MAX) {
+		++g->sinceStepUp;
+	}
+	if (g->frameMs > g->budgetMs) {
+		g->underruns = 0;
+		if (++g->overruns < FPATH_GOVERNOR_OVERRUNS) {
+			return false;
+		}
+		g->overruns = 0;
+		if (quality == FQualityBW) {
+			return false;
+		}
+		// the last step up didn't hold, so wait longer before the next one.
+		if (g->sinceStepUp <= g->settle && g->settle <= UINT8_MAX / 2) {
+			g->settle *= 2;
+		}
+		return fpath_set_quality(fctx, quality - 1);
+	}
+
+	g->overruns = 0;
+	if (4 * g->frameMs > 3 * g->budgetMs) {
+		g->underruns = 0;
+		return false;
+	}
+	if (++g->underruns < g->settle) {
+		return false;
+	}
+	g->underruns = 0;
+	if (quality == FQualityAA || !fpath_set_quality(fctx, quality + 1)) {
+		return false;
+	}
+	g->sinceStepUp = 0;
+	return true;
+}
+#endif
+
+// --------------------------------------------------------------------------
+// Instances - one shape drawn many times.
+// --------------------------------------------------------------------------
+
+/*
+ * Convex if every corner turns the same way and the ring goes around only
+ * once, which it does if x and y each change direction at most twice.
+ * The cross product of two fixed point deltas needs 64 bits: in 32 it
+ * overflows once the edges are longer than about 2896 px.
+ */
+bool fpath_is_convex(FPoint* points, uint32_t num_points) {
+	int32_t turn = 0;
+	int32_t dirX = 0, firstX = 0, changesX = 0;
+	int32_t dirY = 0, firstY = 0, changesY = 0;
+	for (uint32_t k = 0; k < num_points; ++k) {
+		FPoint* a = points + k;
+		FPoint* b = points + (k + 1) % num_points;
+		FPoint* c = points + (k + 2) % num_points;
+		int64_t cross = (int64_t)(b->x - a->x) * (c->y - b->y) - (int64_t)(b->y - a->y) * (c->x - b->x);
+		if (cross) {
+			int32_t t = cross > 0 ? 1 : -1;
+			if (turn && t != turn) return false;
+			turn = t;
+		}
+		int32_t dx = b->x - a->x;
+		if (dx) {
+			int32_t d = dx > 0 ? 1 : -1;
+			if (!dirX) firstX = d; else if (d != dirX) ++changesX;
+			dirX = d;
+		}
+		int32_t dy = b->y - a->y;
+		if (dy) {
+			int32_t d = dy > 0 ? 1 : -1;
+			if (!dirY) firstY = d; else if (d != dirY) ++changesY;
+			dirY = d;
+		}
+	}
+	if (dirX != firstX) ++changesX;
+	if (dirY != firstY) ++changesY;
+	return changesX <= 2 && changesY <= 2;
+}
+
+void fpath_init_geometry(FGeometry* geometry, FPath* fpath) {
+	geometry->num_points = fpath->num_points;
+	geometry->points = fpath->points;
+	geometry->num_contours = fpath->num_contours;
+	geometry->contours = fpath->contours;
+
+	// |x| + |y| bounds the distance from the origin without a square root.
+	geometry->radius = 0;
+	for (uint32_t k = 0; k < fpath->num_points; ++k) {
+		fixed_t r = abs(fpath->points[k].x) + abs(fpath->points[k].y);
+		if (r > geometry->radius) geometry->radius = r;
+	}
+	bool single = !fpath->contours || fpath->num_contours <= 1;
+	geometry->convex = single && fpath_is_convex(fpath->points, fpath->num_points);
+}
+
+void fpath_draw_instances(FContext* fctx, FGeometry* geometry, FInstance* instances, uint32_t count) {
+
+	FPath fpath = {
+		.num_points = geometry->num_points,
+		.points = geometry->points,
+		.num_contours = geometry->num_contours,
+		.contours = geometry->contours,
+	};
+
+	// the target in canvas coordinates, grown by the radius and a pixel.
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	fixed_t reach = geometry->radius + FIXED_POINT_SCALE;
+	fixed_t left = INT_TO_FIXED(fctx->origin.x) - reach;
+	fixed_t top = INT_TO_FIXED(fctx->origin.y) - reach;
+	fixed_t right = INT_TO_FIXED(fctx->origin.x + bounds.size.w - 1) + reach;
+	fixed_t bottom = INT_TO_FIXED(fctx->origin.y + bounds.size.h - 1) + reach;
+
+	// a convex shape is y-monotone at every rotation, so no instance needs testing.
+	fctx->convexHint = geometry->convex;
+	for (uint32_t k = 0; k < count; ++k) {
+		FInstance* instance = instances + k;
+		if (instance->offset.x < left || instance->offset.x > right ||
+		    instance->offset.y < top || instance->offset.y > bottom) {
+			continue;
+		}
+		fpath.rotation = instance->rotation;
+		fpath.offset = instance->offset;
+		// the AA ramp is only rebuilt when the color changes.
+		if (!gcolor_equal(instance->color, fctx->fillColor)) {
+			fpath_set_fill_color(fctx, instance->color);
+		}
+		fpath_begin_fill(fctx);
+		fpath_draw_filled(fctx, &fpath);
+		fpath_end_fill(fctx);
+	}
+	fctx->convexHint = false;
+}
+
+// --------------------------------------------------------------------------
+// Spans - scan conversion with an active edge table instead of flags.
+// --------------------------------------------------------------------------
+
+/*
+ * The edges of a path sorted by the first row they cross.  Each row the
+ * edges starting there join the active list, and edges past their last row
+ * leave it, so the work per row is only in proportion to the edges that
+ * cross it.  The line each edge was set up from is kept with it.
+ */
+typedef struct TableEdge {
+	Edge edge;
+	FPoint top;
+	FPoint bottom;
+	int32_t winding;  // 1 if the path runs down the edge, -1 if up
+} TableEdge;
+
+typedef struct EdgeTable {
+	TableEdge* edges;   // sorted by starting row
+	uint32_t count;
+	uint32_t next;      // first edge not yet active
+	TableEdge** active;
+	uint32_t numActive;
+	int32_t* xs;        // the crossings of the current row
+	int32_t* scratch;   // room for scratchPerEdge values per edge
+} EdgeTable;
+
+bool edge_table_init(EdgeTable* table, FPoint* points, uint32_t num_points,
+                     uint32_t num_contours, uint32_t* contours,
+                     edge_init_func init, uint32_t scratchPerEdge) {
+
+	// one allocation, in order of decreasing alignment.
+	table->active = (TableEdge**)malloc(num_points * (sizeof(TableEdge*) + sizeof(TableEdge) +
+	                                                  (1 + scratchPerEdge) * sizeof(int32_t)));
+	if (!table->active) {
+		return false;
+	}
+	table->edges = (TableEdge*)(table->active + num_points);
+	table->xs = (int32_t*)(table->edges + num_points);
+	table->scratch = table->xs + num_points;
+	table->count = 0;
+	table->next = 0;
+	table->numActive = 0;
+
+	if (!contours || num_contours < 1) {
+		num_contours = 1;
+	}
+	for (uint32_t c = 0; c < num_contours; ++c) {
+		uint32_t begin = contours ? contours[c] : 0;
+		uint32_t end = c + 1 < num_contours ? contours[c + 1] : num_points;
+		for (uint32_t k = begin; k < end; ++k) {
+			FPoint* a = points + k;
+			FPoint* b = points + (k + 1 < end ? k + 1 : begin);
+			TableEdge e;
+			e.top = a->y > b->y ? *b : *a;
+			e.bottom = a->y > b->y ? *a : *b;
+			e.winding = a->y > b->y ? -1 : 1;
+			init(&e.edge, &e.top, &e.bottom);
+			if (e.edge.height <= 0) {
+				continue;
+			}
+			uint32_t i = table->count++;
+			while (i > 0 && table->edges[i - 1].edge.y > e.edge.y) {
+				table->edges[i] = table->edges[i - 1];
+				--i;
+			}
+			table->edges[i] = e;
+		}
+	}
+	return true;
+}
+
+void edge_table_deinit(EdgeTable* table) {
+	free(table->active);
+	table->active = NULL;
+}
+
+bool edge_table_done(EdgeTable* table) {
+	return table->next == table->count && table->numActive == 0;
+}
+
+/*
+ * Activates the edges that start on row y, and gathers where the active
+ * edges cross it into table->xs in ascending order, returning how many.
+ * Crossings are mapped to pixels as (x + offset) / scale and clamped to
+ * [0, maxX], exactly as the flag plotting functions do.
+ */
+uint32_t edge_table_row(EdgeTable* table, int32_t y, int32_t offset, int32_t scale, int32_t maxX) {
+	while (table->next < table->count && table->edges[table->next].edge.y <= y) {
+		table->active[table->numActive++] = &table->edges[table->next++];
+	}
+	for (uint32_t k = 0; k < table->numActive; ++k) {
+		int32_t x = fpath_clamp((table->active[k]->edge.x + offset) / scale, 0, maxX);
+		uint32_t i = k;
+		while (i > 0 && table->xs[i - 1] > x) {
+			table->xs[i] = table->xs[i - 1];
+			--i;
+		}
+		table->xs[i] = x;
+	}
+	return table->numActive;
+}
+
+// Steps the active edges down to the next row, dropping the finished ones.
+void edge_table_step(EdgeTable* table) {
+	uint32_t kept = 0;
+	for (uint32_t k = 0; k < table->numActive; ++k) {
+		if (edge_step(&table->active[k]->edge) > 0) {
+			table->active[kept++] = table->active[k];
+		}
+	}
+	table->numActive = kept;
+}
+
+// each pair of crossings on a row delimits a span of inside pixels.
+void fpath_spans_bw(EdgeTable* table, int32_t width, int32_t height, FSpanFunc func, void* data) {
+	for (int32_t y = table->edges[0].edge.y; y < height && !edge_table_done(table); ++y) {
+		uint32_t n = edge_table_row(table, y, 0, 1, width);
+		if (y >= 0) {
+			for (uint32_t i = 0; i + 1 < n; i += 2) {
+				if (table->xs[i] < table->xs[i + 1]) {
+					func(data, y, table->xs[i], table->xs[i + 1], FPATH_FULL_COVERAGE);
+				}
+			}
+		}
+		edge_table_step(table);
+	}
+}
+
+#ifdef PBL_COLOR
+/*
+ * Each pixel row is scanned as SUBPIXEL_COUNT subrows.  The inside runs of
+ * every subrow become +1 and -1 events (x * 2, plus 1 for the ends), and a
+ * sweep over the sorted events gives the number of subrows covering each
+ * pixel, the same count the flag buffer resolve makes.
+ */
+void fpath_spans_aa(EdgeTable* table, int32_t width, int32_t height, FSpanFunc func, void* data) {
+
+	int32_t* events = table->scratch;
+	int32_t top = table->edges[0].edge.y;
+	int32_t pixelY = top >= 0 ? top / SUBPIXEL_COUNT : -((SUBPIXEL_COUNT - 1 - top) / SUBPIXEL_COUNT);
+
+	for (; pixelY < height && !edge_table_done(table); ++pixelY) {
+		uint32_t numEvents = 0;
+		for (int32_t ySub = 0; ySub < SUBPIXEL_COUNT; ++ySub) {
+			int32_t y = pixelY * SUBPIXEL_COUNT + ySub;
+			uint32_t n = edge_table_row(table, y, offsets[ySub], SUBPIXEL_COUNT, width);
+			for (uint32_t i = 0; i + 1 < n; i += 2) {
+				if (table->xs[i] < table->xs[i + 1]) {
+					events[numEvents++] = table->xs[i] * 2;
+					events[numEvents++] = table->xs[i + 1] * 2 + 1;
+				}
+			}
+			edge_table_step(table);
+		}
+		if (pixelY < 0 || !numEvents) {
+			continue;
+		}
+
+		for (uint32_t k = 1; k < numEvents; ++k) {
+			int32_t e = events[k];
+			uint32_t i = k;
+			while (i > 0 && events[i - 1] > e) {
+				events[i] = events[i - 1];
+				--i;
+			}
+			events[i] = e;
+		}
+		int32_t coverage = 0;
+		int32_t x = 0;
+		for (uint32_t k = 0; k < numEvents; ++k) {
+			int32_t eventX = events[k] / 2;
+			if (eventX > x && coverage > 0) {
+				func(data, pixelY, x, eventX, coverage);
+			}
+			x = eventX;
+			coverage += (events[k] & 1) ? -1 : 1;
+		}
+	}
+}
+#endif
+
+void fpath_fill_spans(FContext* fctx, FPath* fpath, FSpanFunc func, void* data) {
+
+	bool aa = fctx->renderer->aa;
+	FPoint* points = fpath_transform(fctx, fpath, aa ? -1 : -FIXED_POINT_SCALE / 2);
+	if (!points) {
+		return;
+	}
+
+	// the flag buffer is a pixel larger than the target.
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	int32_t width = bounds.size.w - 1;
+	int32_t height = bounds.size.h - 1;
+
+	EdgeTable table;
+#ifdef PBL_COLOR
+	if (aa) {
+		if (edge_table_init(&table, points, fpath->num_points, fpath->num_contours,
+		                    fpath->contours, &edge_init_aa, SUBPIXEL_COUNT)) {
+			STAT_ADD(fctx, edgesSetUp, table.count);
+			if (table.count) {
+				fpath_spans_aa(&table, width, height, func, data);
+			}
+			edge_table_deinit(&table);
+		}
+		return;
+	}
+#endif
+	if (edge_table_init(&table, points, fpath->num_points, fpath->num_contours,
+	                    fpath->contours, &edge_init, 0)) {
+		STAT_ADD(fctx, edgesSetUp, table.count);
+		if (table.count) {
+			fpath_spans_bw(&table, width, height, func, data);
+		}
+		edge_table_deinit(&table);
+	}
+}
+
+#ifdef PBL_COLOR
+// --------------------------------------------------------------------------
+// Area - anti-aliasing by the exact area covered in each pixel.
+// --------------------------------------------------------------------------
+
+/*
+ * Positions are in 1/256ths of a pixel (AREA_ONE), so the coverage of a
+ * pixel is in 1/65536ths.  Each pixel row of an edge is cut where it
+ * crosses from one cell (pixel) to the next; every piece adds its height,
+ * signed by the direction of the path, to the cover of its cell, and its
+ * height times the sum of its x at either end (within the cell) to the
+ * area.  Along the row, the winding of a pixel is then the cover of all the
+ * cells left of it, plus the part of its own cell right of the pieces in
+ * it, and folding that modulo two gives the even-odd rule.
+ */
+#define AREA_SHIFT 8
+#define AREA_ONE (1 << AREA_SHIFT)
+#define AREA_FULL (AREA_ONE * AREA_ONE)
+
+/*
+ * Sets up an edge to step down from the top of pixel row y, with x where it
+ * crosses the top of each row, in AREA_ONE units and rounded down.  From
+ * the row the edge starts on, the offset and the step fit in 32 bits; only
+ * an edge that starts above the target is moved further down, which takes
+ * 64 bits, once.
+ */
+void edge_seek_rows(Edge* e, FPoint* top, FPoint* bottom, int32_t y) {
+	const int32_t S = AREA_ONE / FIXED_POINT_SCALE;
+	int32_t dx = bottom->x - top->x;
+	int32_t dy = bottom->y - top->y;
+	int32_t offset, mod;
+	if (y <= e->y) {
+		floorDivMod((INT_TO_FIXED(y) - top->y) * dx * S, dy, &offset, &mod);
+	} else {
+		int64_t n = (int64_t)(INT_TO_FIXED(y) - top->y) * dx * S;
+		offset = (int32_t)(n / dy);
+		mod = (int32_t)(n % dy);
+		if (mod < 0) {
+			--offset;
+			mod += dy;
+		}
+	}
+	e->x = top->x * S + offset;
+	e->errorTerm = mod;
+	floorDivMod(dx * AREA_ONE, dy, &e->xStep, &e->numerator);
+	e->denominator = dy;
+	e->height -= y - e->y;
+	e->y = y;
+}
+
+// the pixel rows an edge crosses any part of.
+void edge_init_rows(Edge* e, FPoint* top, FPoint* bottom) {
+	int32_t mod, end;
+	floorDivMod(top->y, FIXED_POINT_SCALE, &e->y, &mod);
+	floorDivMod(bottom->y + FIXED_POINT_SCALE - 1, FIXED_POINT_SCALE, &end, &mod);
+	e->height = top->y == bottom->y ? 0 : end - e->y;
+	if (e->height > 0) {
+		edge_seek_rows(e, top, bottom, e->y);
+	}
+}
+
+/*
+ * Accumulates the part of an edge within one pixel row, from (x0, y0) to
+ * (x1, y1) with x0 <= x1 and y relative to the top of the row, counting
+ * winding times its height.  The cells
+ * are offset by one: cell 0 collects the cover of whatever lies left of the
+ * target.  Whatever lies right of it can't affect the target.  The cells
+ * from 1 up that it touches are added to the range lo..hi.
+ */
+void fpath_area_line(int32_t* cover, int32_t* area, int32_t width, int32_t winding,
+                     int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                     int32_t* lo, int32_t* hi) {
+
+	int32_t right = width * AREA_ONE;
+	if (x0 >= right) {
+		return;
+	}
+	// y where the line crosses each cell boundary is taken from its ends as
+	// given, even once it's clipped, so that the cells of a tile get the
+	// same pieces as on the canvas the tile was cut from.
+	const int32_t lineX = x0, lineY = y0, dx = x1 - x0, dy = y1 - y0;
+	if (x1 > right) {
+		y1 = lineY + (right - lineX) * dy / dx;
+		x1 = right;
+	}
+	if (x0 < 0) {
+		int32_t y = x1 <= 0 ? y1 : lineY - lineX * dy / dx;
+		cover[0] += winding * abs(y - y0);
+		if (x1 <= 0) {
+			return;
+		}
+		x0 = 0;
+		y0 = y;
+	}
+
+	int32_t cell = x0 >> AREA_SHIFT;
+	int32_t last = (x1 > x0 && (x1 & (AREA_ONE - 1)) == 0) ? (x1 >> AREA_SHIFT) - 1 : x1 >> AREA_SHIFT;
+	if (cell + 1 < *lo) {
+		*lo = cell + 1;
+	}
+	if (last + 1 > *hi) {
+		*hi = last + 1;
+	}
+	int32_t x = x0;
+	int32_t y = y0;
+	for (; cell < last; ++cell) {
+		int32_t xNext = (cell + 1) << AREA_SHIFT;
+		int32_t yNext = lineY + (xNext - lineX) * dy / dx;
+		int32_t h = winding * abs(yNext - y);
+		cover[cell + 1] += h;
+		area[cell + 1] += h * (x - (cell << AREA_SHIFT) + AREA_ONE);
+		x = xNext;
+		y = yNext;
+	}
+	int32_t h = winding * abs(y1 - y);
+	cover[cell + 1] += h;
+	area[cell + 1] += h * (x + x1 - 2 * (cell << AREA_SHIFT));
+}
+
+// the coverage of a pixel from its winding, by the even-odd rule, in eighths.
+uint8_t fpath_area_coverage(int32_t v) {
+	v = abs(v) & (2 * AREA_FULL - 1);
+	if (v > AREA_FULL) {
+		v = 2 * AREA_FULL - v;
+	}
+	return (v * FPATH_FULL_COVERAGE + AREA_FULL / 2) / AREA_FULL;
+}
+
+/*
+ * The cells start clear and each row clears only the ones its edges
+ * touched, so a row costs the width of the path rather than the target.
+ * Left and right of those cells the running cover is constant, and each
+ * side is one span.
+ */
+void fpath_area_spans(EdgeTable* table, int32_t width, int32_t height,
+                      int32_t* cover, int32_t* area, FSpanFunc func, void* data) {
+
+	int32_t row = table->edges[0].edge.y;
+	if (row < 0) {
+		row = 0;
+	}
+	memset(cover, 0, (width + 1) * sizeof(int32_t));
+	memset(area, 0, (width + 1) * sizeof(int32_t));
+	for (; row < height && !edge_table_done(table); ++row) {
+
+		int32_t rowTop = INT_TO_FIXED(row);
+		int32_t rowBottom = INT_TO_FIXED(row + 1);
+		while (table->next < table->count && table->edges[table->next].edge.y <= row) {
+			TableEdge* e = &table->edges[table->next++];
+			if (e->edge.y < row) {
+				edge_seek_rows(&e->edge, &e->top, &e->bottom, row);
+			}
+			table->active[table->numActive++] = e;
+		}
+		int32_t lo = width + 1;
+		int32_t hi = 0;
+
+		// one walk of each active edge, clipped to the row.  The edge's x
+		// steps from the top of the row to the bottom, and its ends are
+		// taken exactly.
+		uint32_t kept = 0;
+		for (uint32_t k = 0; k < table->numActive; ++k) {
+			TableEdge* e = table->active[k];
+			const int32_t S = AREA_ONE / FIXED_POINT_SCALE;
+			int32_t ya = e->top.y > rowTop ? e->top.y : rowTop;
+			int32_t yb = e->bottom.y < rowBottom ? e->bottom.y : rowBottom;
+			int32_t xa = e->top.y >= rowTop ? e->top.x * S : e->edge.x;
+			edge_step(&e->edge);
+			int32_t xb = e->bottom.y <= rowBottom ? e->bottom.x * S : e->edge.x;
+			if (yb > ya) {
+				int32_t la = (ya - rowTop) * S;
+				int32_t lb = (yb - rowTop) * S;
+				if (xa <= xb) {
+					fpath_area_line(cover, area, width, e->winding, xa, la, xb, lb, &lo, &hi);
+				} else {
+					fpath_area_line(cover, area, width, e->winding, xb, lb, xa, la, &lo, &hi);
+				}
+			}
+			if (e->bottom.y > rowBottom) {
+				table->active[kept++] = e;
+			}
+		}
+		table->numActive = kept;
+
+		// fold the running total over the touched cells, clearing them for
+		// the next row, and round it to the nearest eighth.
+		int32_t run = cover[0];
+		cover[0] = 0;
+		int32_t x = 0;
+		int32_t spanBegin = 0;
+		uint8_t spanCoverage = 0;
+		if (lo <= hi) {
+			if (lo > 1) {
+				spanCoverage = fpath_area_coverage(run * AREA_ONE);
+			}
+			for (x = lo - 1; x < hi; ++x) {
+				uint8_t coverage = fpath_area_coverage((run + cover[x + 1]) * AREA_ONE - area[x + 1] / 2);
+				run += cover[x + 1];
+				if (coverage != spanCoverage) {
+					if (spanCoverage) {
+						func(data, row, spanBegin, x, spanCoverage);
+					}
+					spanBegin = x;
+					spanCoverage = coverage;
+				}
+			}
+			memset(cover + lo, 0, (hi - lo + 1) * sizeof(int32_t));
+			memset(area + lo, 0, (hi - lo + 1) * sizeof(int32_t));
+		}
+		if (x < width) {
+			uint8_t coverage = fpath_area_coverage(run * AREA_ONE);
+			if (coverage != spanCoverage) {
+				if (spanCoverage) {
+					func(data, row, spanBegin, x, spanCoverage);
+				}
+				spanBegin = x;
+				spanCoverage = coverage;
+			}
+		}
+		if (spanCoverage) {
+			func(data, row, spanBegin, width, spanCoverage);
+		}
+	}
+}
+
+// the cells are kept by the context, as they are the same size every time.
+bool fpath_reserve_cells(FContext* fctx, uint32_t num_cells) {
+	if (num_cells > fctx->cellsCapacity) {
+		int32_t* cells = (int32_t*)realloc(fctx->cells, num_cells * sizeof(int32_t));
+		if (!cells) {
+			return false;
+		}
+		fctx->cells = cells;
+		fctx->cellsCapacity = num_cells;
+		STAT_HEAP(fctx);
+	}
+	return true;
+}
+
+void fpath_fill_area_spans(FContext* fctx, FPath* fpath, FSpanFunc func, void* data) {
+
+	FPoint* points = fpath_transform(fctx, fpath, 0);
+	if (!points) {
+		return;
+	}
+
+	// the flag buffer is a pixel larger than the target.
+	GRect bounds = gbitmap_get_bounds(fctx->flagBuffer);
+	int32_t width = bounds.size.w - 1;
+	int32_t height = bounds.size.h - 1;
+
+	EdgeTable table;
+	if (!edge_table_init(&table, points, fpath->num_points, fpath->num_contours,
+	                     fpath->contours, &edge_init_rows, 0)) {
+		return;
+	}
+	STAT_ADD(fctx, edgesSetUp, table.count);
+	if (table.count && fpath_reserve_cells(fctx, 2 * (width + 1))) {
+		fpath_area_spans(&table, width, height, fctx->cells, fctx->cells + width + 1, func, data);
+	}
+	edge_table_deinit(&table);
+}
+
+typedef struct AreaPainter {
+	FContext* fctx;
+	Target* t;
+	GRect drawn;
+} AreaPainter;
+
+void fpath_paint_area_span(void* data, int32_t y, int32_t x0, int32_t x1, uint8_t coverage) {
+	AreaPainter* painter = (AreaPainter*)data;
+	fpath_span(painter->t, y, x0, x1, fpath_ramp_byte(painter->fctx, painter->t, coverage));
+	painter->drawn = fpath_union_bounds(painter->drawn, GRect(x0, y, x1 - x0, 1));
+}
+
+void fpath_fill_area(FContext* fctx, FPath* fpath) {
+
+	if (fctx->aarampDirty) {
+		fpath_calc_ramp_aa(fctx);
+	}
+	Target t;
+	if (!fpath_capture_target(fctx, &t)) {
+		return;
+	}
+	AreaPainter painter = { fctx, &t, GRectZero };
+	fpath_fill_area_spans(fctx, fpath, &fpath_paint_area_span, &painter);
+	fpath_add_drawn(fctx, painter.drawn);
+	fpath_release_target(fctx, &t);
+}
+#endif
+
+// --------------------------------------------------------------------------
+// Lines - anti-aliased hairlines drawn straight into the target.
+// --------------------------------------------------------------------------
+
+// the minor axis position of a line, in 1/4096ths of a pixel.
+#define LINE_SHIFT 12
+#define LINE_ONE (1 << LINE_SHIFT)
+
+typedef struct LinePlot {
+	FContext* fctx;
+	Target t;
+	bool aa;
+	uint8_t fill;
+} LinePlot;
+
+bool fpath_begin_lines(FContext* fctx, LinePlot* p) {
+	if (!fpath_capture_target(fctx, &p->t)) {
+		return false;
+	}
+	p->fctx = fctx;
+	p->fill = fpath_fill_byte(fctx, &p->t);
+	p->aa = false;
+#ifdef PBL_COLOR
+	p->aa = fctx->renderer->aa && !p->t.bw;
+	if (p->aa && fctx->aarampDirty) {
+		fpath_calc_ramp_aa(fctx);
+	}
+#endif
+	return true;
+}
+
+/*
+ * Plots one pixel of a line with the given coverage, in eighths.  Without
+ * AA the pixels from half coverage up take the fill color.  With AA a pixel
+ * takes the ramp color for its coverage, unless it already holds the ramp
+ * color for more, so that lines meeting or crossing don't lighten each other.
+ */
+void fpath_line_pixel(LinePlot* p, int32_t x, int32_t y, uint8_t coverage) {
+	Target* t = &p->t;
+	if (coverage == 0 || x < 0 || x >= t->width || y < 0 || y >= t->height) {
+		return;
+	}
+	uint8_t* row = t->data + t->stride * y;
+#ifdef PBL_COLOR
+	if (p->aa) {
+		for (uint8_t k = SUBPIXEL_COUNT; k > coverage; --k) {
+			if (row[x] == p->fctx->aaramp[k].argb) {
+				return;
+			}
+		}
+		fpath_put(t, row, x, p->fctx->aaramp[coverage].argb);
+		return;
+	}
+#endif
+	if (coverage * 2 >= FPATH_FULL_COVERAGE) {
+		fpath_put(t, row, x, p->fill);
+	}
+}
+
+/*
+ * Xiaolin Wu's line: one step per pixel along the major axis, for the pixel
+ * centers from a to b inclusive, splitting the coverage between the two
+ * pixels either side of the line across the minor axis.  The minor position
+ * is stepped exactly, as a quotient and a remainder over the major length.
+ */
+void fpath_line(LinePlot* p, FPoint a, FPoint b) {
+	int32_t dx = b.x - a.x;
+	int32_t dy = b.y - a.y;
+	bool steep = abs(dy) > abs(dx);
+	if (steep) {
+		a = FPoint(a.y, a.x);
+		b = FPoint(b.y, b.x);
+		int32_t d = dx;
+		dx = dy;
+		dy = d;
+	}
+	if (dx < 0) {
+		FPoint c = a;
+		a = b;
+		b = c;
+		dx = -dx;
+		dy = -dy;
+	}
+	if (dx == 0) {
+		return;
+	}
+
+	// the columns (rows, if steep) with centers on the line, clipped.
+	int32_t first, last, mod;
+	floorDivMod(a.x - FIXED_POINT_SCALE / 2 + FIXED_POINT_SCALE - 1, FIXED_POINT_SCALE, &first, &mod);
+	floorDivMod(b.x - FIXED_POINT_SCALE / 2, FIXED_POINT_SCALE, &last, &mod);
+	int32_t limit = steep ? p->t.height : p->t.width;
+	if (first < 0) first = 0;
+	if (last > limit - 1) last = limit - 1;
+	if (first > last) {
+		return;
+	}
+
+	const int32_t S = LINE_ONE / FIXED_POINT_SCALE;
+	int64_t n = (int64_t)(INT_TO_FIXED(first) + FIXED_POINT_SCALE / 2 - a.x) * dy * S;
+	int32_t y = a.y * S + (int32_t)(n / dx);
+	int32_t error = (int32_t)(n % dx);
+	if (error < 0) {
+		--y;
+		error += dx;
+	}
+	int32_t yStep, errorStep;
+	floorDivMod(dy * LINE_ONE, dx, &yStep, &errorStep);
+
+	for (int32_t x = first; x <= last; ++x) {
+		int32_t row, frac;
+		floorDivMod(y - LINE_ONE / 2, LINE_ONE, &row, &frac);
+		uint8_t below = (frac * FPATH_FULL_COVERAGE + LINE_ONE / 2) >> LINE_SHIFT;
+		if (steep) {
+			fpath_line_pixel(p, row, x, FPATH_FULL_COVERAGE - below);
+			fpath_line_pixel(p, row + 1, x, below);
+		} else {
+			fpath_line_pixel(p, x, row, FPATH_FULL_COVERAGE - below);
+			fpath_line_pixel(p, x, row + 1, below);
+		}
+		y += yStep;
+		error += errorStep;
+		if (error >= dx) {
+			++y;
+			error -= dx;
+		}
+	}
+}
+
+void fpath_draw_line(FContext* fctx, FPoint p0, FPoint p1) {
+	LinePlot p;
+	if (!fpath_begin_lines(fctx, &p)) {
+		return;
+	}
+	FPoint origin = FPointI(fctx->origin.x, fctx->origin.y);
+	FPoint ends[2] = { FPoint(p0.x - origin.x, p0.y - origin.y), FPoint(p1.x - origin.x, p1.y - origin.y) };
+	fpath_line(&p, ends[0], ends[1]);
+	fpath_add_drawn_points(fctx, ends, 2);
+	fpath_release_target(fctx, &p.t);
+}
+
+void fpath_draw_polyline(FContext* fctx, FPath* fpath, bool closed) {
+	FPoint* points = fpath_transform(fctx, fpath, 0);
+	LinePlot p;
+	if (!points || !fpath_begin_lines(fctx, &p)) {
+		return;
+	}
+	uint32_t num_contours = fpath->contours && fpath->num_contours ? fpath->num_contours : 1;
+	for (uint32_t c = 0; c < num_contours; ++c) {
+		uint32_t begin = fpath->contours ? fpath->contours[c] : 0;
+		uint32_t end = c + 1 < num_contours ? fpath->contours[c + 1] : fpath->num_points;
+		for (uint32_t k = begin; k + 1 < end; ++k) {
+			fpath_line(&p, points[k], points[k + 1]);
+		}
+		if (closed && end - begin > 2) {
+			fpath_line(&p, points[end - 1], points[begin]);
+		}
+	}
+	fpath_add_drawn_points(fctx, points, fpath->num_points);
+	fpath_release_target(fctx, &p.t);
+}
+
+void fpath_set_origin(FContext* fctx, GPoint origin) {
+	fctx->origin = origin;
+}
+
+void fpath_draw_mask(FContext* fctx, GBitmap* coverage, GPoint origin) {
+	origin.x -= fctx->origin.x;
+	origin.y -= fctx->origin.y;
+	GRect maskBounds = gbitmap_get_bounds(coverage);
+	fpath_add_drawn(fctx, GRect(origin.x, origin.y, maskBounds.size.w, maskBounds.size.h));
+#ifdef PBL_COLOR
+	if (gbitmap_get_format(coverage) == GBitmapFormat8Bit) {
+		fpath_draw_mask_aa(fctx, coverage, origin);
+		return;
+	}
+#endif
+	fpath_draw_mask_bw(fctx, coverage, origin);
+}
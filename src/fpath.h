@@ -2,6 +2,10 @@
 #pragma once
 #include <pebble.h>
 
+// Define FPATH_STATS to have each FContext count the work done by the
+// rasterizer in its stats member.  Without it the counters compile away.
+// #define FPATH_STATS
+
 typedef int32_t fixed_t;
 
 // Defines the fixed point conversions
@@ -35,23 +39,91 @@ typedef struct FPathInfo {
     FPoint* points;
 } FPathInfo;
 
+// Points are rotated with 32 bit products, so they must lie within 2047
+// pixels of (0, 0); the offset moves them anywhere.
 typedef struct FPath {
 	uint32_t num_points;
 	FPoint* points;
 	int32_t rotation;
 	FPoint offset;
+	uint32_t num_contours;
+	uint32_t* contours; // index of the first point of each contour, or NULL for one contour
 } FPath;
 
+// A compact path, for keeping many of them: the same as FPath, but with
+// 12.4 fixed point coordinates in 16 bits, for 4 bytes per point instead of
+// 8.  Points must lie within 2047 pixels of (0, 0).  Only the points are
+// compact; rotation and offset are kept at full precision.
+typedef struct FPoint16 {
+	int16_t x;
+	int16_t y;
+} FPoint16;
+
+typedef struct FPath16 {
+	uint32_t num_points;
+	FPoint16* points;
+	int32_t rotation;
+	FPoint offset;
+	uint32_t num_contours;
+	uint32_t* contours;
+} FPath16;
+
+#ifdef FPATH_STATS
+typedef struct FStats {
+	uint32_t verticesTransformed;
+	uint32_t edgesSetUp;
+	uint32_t rowsPlotted;     // edge rows walked, in subpixel rows for AA
+	uint32_t pixelsResolved;  // flag buffer pixels scanned
+	uint32_t pixelsWritten;   // target pixels written
+	uint32_t captures;        // frame buffer captures
+	uint32_t heapBytes;       // held by the flag buffer and scratch points and cells
+	uint32_t transformMs;     // elapsed time per stage, in milliseconds
+	uint32_t plotMs;
+	uint32_t resolveMs;
+} FStats;
+#endif
+
+#ifdef PBL_COLOR
+// State of the quality governor, see fpath_set_frame_budget.
+typedef struct FGovernor {
+	uint32_t frameBegin;     // time of fpath_begin_frame, in milliseconds
+	uint16_t budgetMs;       // 0 when the governor is off
+	uint16_t frameMs;        // time taken by the last frame
+	uint8_t overruns;        // frames in a row over budget
+	uint8_t underruns;       // frames in a row within three quarters of it
+	uint8_t settle;          // underruns needed to step up
+	uint8_t sinceStepUp;     // frames since the last step up, up to 255
+} FGovernor;
+#endif
+
 typedef struct FContext {
+	const struct FRenderer* renderer;
 	GContext* gctx;
-	GBitmap* flagBuffer;
+	GBitmap* target;         // offscreen target, or NULL to draw into the frame buffer of gctx
+	GPoint origin;           // canvas position of the target's top left corner
+	GRect drawn;             // canvas bounds of what was drawn since fpath_take_drawn
+	GBitmap* flagBuffer;      // shared with other contexts of the same size and format
+	bool privateFlags;       // flagBuffer is the context's own, see fpath_use_private_flags
 	FPoint min;
 	FPoint max;
+	FPoint* points;          // scratch buffer for transformed points
+	uint32_t pointsCapacity;
+	uint32_t pendingPoints;  // y-monotone path deferred to end_fill
+	bool flagsDirty;         // edges have been plotted into flagBuffer
+	bool convexHint;         // paths being drawn are known to be convex
+	int32_t plotEdge;        // next edge for fpath_draw_filled_step, -1 before the first step
+	int32_t resolveRow;      // next row for fpath_end_fill_mask_step, -1 before the first step
 	GColor strokeColor;
     GColor fillColor;
 #ifdef PBL_COLOR
 	bool aarampDirty;
 	GColor8 aaramp[9];
+	FGovernor governor;
+	int32_t* cells;          // scratch row of cover and area cells for fpath_fill_area
+	uint32_t cellsCapacity;
+#endif
+#ifdef FPATH_STATS
+	FStats stats;
 #endif
 } FContext;
 
@@ -61,19 +133,220 @@ void fpath_move_to(FPath* path, FPoint point);
 
 void fpath_set_fill_color(FContext* fctx, GColor c);
 void fpath_set_stroke_color(FContext* fctx, GColor c);
+#ifdef FPATH_STATS
+// zero the counters and timings, heapBytes is kept.
+void fpath_reset_stats(FContext* fctx);
+#endif
 #ifdef PBL_COLOR
+// Selects the renderer that fpath_init_context and fpath_init_context_bitmap
+// give to contexts initialized afterwards.  Existing contexts keep theirs.
 void fpath_enable_aa(bool enable);
 bool fpath_is_aa_enabled();
 #endif
 
-typedef void (*fpath_init_context_func)(FContext* fctx, GContext* gctx);
 typedef void (*fpath_begin_fill_func)(FContext* fctx);
+typedef void (*fpath_plot_edge_func)(FContext* fctx, FPoint* a, FPoint* b);
 typedef void (*fpath_draw_filled_func)(FContext* fctx, FPath* fpath);
+typedef void (*fpath_draw_filled16_func)(FContext* fctx, FPath16* fpath);
 typedef void (*fpath_end_fill_func)(FContext* fctx);
-typedef void (*fpath_deinit_context_func)(FContext* fctx);
+typedef void (*fpath_end_fill_mask_func)(FContext* fctx, GBitmap* coverage);
+typedef bool (*fpath_end_fill_mask_step_func)(FContext* fctx, GBitmap* coverage, uint16_t max_rows);
+
+// The fill functions of one kind of rasterizer, chosen per context.
+typedef struct FRenderer {
+	fpath_begin_fill_func begin_fill;
+	fpath_plot_edge_func plot_edge;
+	fpath_draw_filled_func draw_filled;
+	fpath_draw_filled16_func draw_filled16;
+	fpath_end_fill_func end_fill;
+	fpath_end_fill_mask_func end_fill_mask;
+	fpath_end_fill_mask_step_func end_fill_mask_step;
+	int32_t adjust;          // added to every transformed point, to sample at pixel or subpixel centers
+	bool aa;
+} FRenderer;
+
+// Each context is bound to a renderer when it is initialized, so BW and AA
+// contexts, of any size and target, can be used side by side.  Contexts of
+// the same size and flag format share one flag buffer, freed with the last
+// of them, unless fpath_use_private_flags gives one its own (see below).
+void fpath_init_context(FContext* fctx, GContext* gctx);
+void fpath_init_context_bitmap(FContext* fctx, GBitmap* target);
+void fpath_init_context_bw(FContext* fctx, GContext* gctx);
+void fpath_init_context_bitmap_bw(FContext* fctx, GBitmap* target);
+#ifdef PBL_COLOR
+void fpath_init_context_aa(FContext* fctx, GContext* gctx);
+void fpath_init_context_bitmap_aa(FContext* fctx, GBitmap* target);
+#endif
+void fpath_begin_fill(FContext* fctx);
+void fpath_draw_filled(FContext* fctx, FPath* fpath);
+void fpath_draw_filled16(FContext* fctx, FPath16* fpath);
+void fpath_end_fill(FContext* fctx);
+void fpath_end_fill_mask(FContext* fctx, GBitmap* coverage);
+bool fpath_end_fill_mask_step(FContext* fctx, GBitmap* coverage, uint16_t max_rows);
+bool fpath_draw_filled_step(FContext* fctx, FPath* fpath, uint16_t max_edges);
+void fpath_deinit_context(FContext* fctx);
+bool fpath_is_context_aa(FContext* fctx);
+
+// Contexts of the same size share one flag buffer per flag format (1 bit for
+// BW, 8 bits for AA), which is clean again after every fill.  That's enough
+// for contexts drawing one after another, but not for two fills at once: a
+// fill resolved over several calls of fpath_end_fill_mask_step while another
+// context of the same size draws, or contexts used from several threads.
+// fpath_use_private_flags gives a context a flag buffer of its own for the
+// rest of its life, including when fpath_set_quality changes its format.
+// It returns false, keeping the shared buffer, if there isn't enough memory
+// or a fill is in progress.
+bool fpath_use_private_flags(FContext* fctx);
+
+// fpath_draw_filled16 fills a compact path, exactly as fpath_draw_filled
+// fills the FPath it was made from.  fpath_create_path16 makes one in a
+// single allocation, like fpath_builder_create_path, and returns NULL if a
+// point is out of range; free it with fpath_destroy16.
+FPath16* fpath_create_path16(FPath* fpath);
+void fpath_destroy16(FPath16* fpath);
+
+// fpath_init_context_bitmap sets up a context that draws into an offscreen
+// GBitmap (GBitmapFormat1Bit or GBitmapFormat8Bit, any size) instead of the
+// frame buffer, with its flag buffer sized to match.  The bitmap must outlive
+// the context.  On 1-bit targets AA coverage is thresholded at one half.
+
+// Coverage masks keep the result of a fill so that it can be stamped again
+// later without rasterizing.  Use fpath_end_fill_mask in place of
+// fpath_end_fill, with path coordinates relative to the top left corner of
+// the mask.  BW masks are GBitmapFormat1Bit, AA masks are GBitmapFormat8Bit
+// holding the number of covered subpixels (0-8) for each pixel.
+// fpath_end_fill_mask_step does the same work at most max_rows rows at a
+// time, returning true when it is done, so that a fill can be resolved in
+// idle time.  The flag buffer is in use until then, so unless the context
+// has private flags (fpath_use_private_flags), no other context of the same
+// size may draw before the last step.  fpath_draw_filled_step likewise plots
+// a path into the flag buffer at most max_edges edges at a time, returning
+// true once all of it is in; the path must not change, and the context must
+// draw nothing else, until then.
+void fpath_draw_mask(FContext* fctx, GBitmap* coverage, GPoint origin);
+
+// fpath_fill_spans scan converts a path the way the context's renderer
+// fills it, but without the flag buffer: it keeps a table of the edges
+// crossing each row, and passes func the spans of pixels x0 <= x < x1 on
+// row y that have the same coverage, in eighths of a pixel (BW spans are
+// always FPATH_FULL_COVERAGE).  Spans come top to bottom, left to right
+// within a row, and clipped to the target.  Overlapping paths are not
+// merged, so call it once per path.  It uses the context's scratch points,
+// so it must not be called while a fill is in progress.
+#define FPATH_FULL_COVERAGE 8
+typedef void (*FSpanFunc)(void* data, int32_t y, int32_t x0, int32_t x1, uint8_t coverage);
+void fpath_fill_spans(FContext* fctx, FPath* fpath, FSpanFunc func, void* data);
+
+#ifdef PBL_COLOR
+// fpath_fill_area anti-aliases by the exact area of each pixel inside the
+// path, from one walk of each edge per pixel row, rather than by sampling
+// subpixel rows.  The coverage is rounded to eighths and drawn through the
+// same ramp as the AA renderer.  Like fpath_fill_spans it fills one path on
+// its own, outside of begin_fill and end_fill, and can be used with either
+// kind of context.  Where a path crosses itself within a pixel, the areas on
+// either side of the crossing partly cancel, so that pixel comes out light.
+// The context keeps two rows of cells for it, allocated on first use.
+// fpath_fill_area_spans hands the spans to func instead.
+void fpath_fill_area(FContext* fctx, FPath* fpath);
+void fpath_fill_area_spans(FContext* fctx, FPath* fpath, FSpanFunc func, void* data);
+#endif
+
+// fpath_draw_line draws an anti-aliased hairline between two points, in
+// canvas coordinates, straight into the target.  fpath_draw_polyline draws
+// each contour of a path (rotated and moved like a fill) as a connected run
+// of them, joining the last point back to the first if closed is set.  Lines
+// are one pixel wide, sampled at pixel centers with the coverage split
+// between the two pixels nearest the line (Xiaolin Wu's algorithm).  They are
+// drawn in the fill color; on AA contexts they blend into the stroke color
+// through the same ramp as fills, so the stroke color should be the
+// background, and where lines meet the more covered pixel wins.  BW contexts
+// and 1-bit targets plot the pixels that are at least half covered.
+// fpath_draw_polyline uses the context's scratch points, so it must not be
+// called while a fill is in progress.
+void fpath_draw_line(FContext* fctx, FPoint p0, FPoint p1);
+void fpath_draw_polyline(FContext* fctx, FPath* fpath, bool closed);
+
+// An FGeometry shares the points and contours of a path, with what can be
+// worked out about them once: a bound on their distance from (0, 0), and
+// whether they make a convex polygon.  Each FInstance places and colors one
+// copy of it, so a shape repeated around a dial costs one set of points and
+// a few bytes per copy.  fpath_init_geometry does not copy the path, which
+// must outlive the geometry; its rotation and offset are not used.
+// fpath_draw_instances fills each instance in turn, skipping those that
+// can't reach the target without transforming them, and spanning convex
+// shapes straight into the target without testing each one.  It changes
+// the context's fill color to that of each instance.
+typedef struct FGeometry {
+	uint32_t num_points;
+	FPoint* points;
+	uint32_t num_contours;
+	uint32_t* contours;
+	fixed_t radius;          // no point is further than this from (0, 0)
+	bool convex;
+} FGeometry;
+
+typedef struct FInstance {
+	int32_t rotation;
+	FPoint offset;
+	GColor color;
+} FInstance;
+
+void fpath_init_geometry(FGeometry* geometry, FPath* fpath);
+void fpath_draw_instances(FContext* fctx, FGeometry* geometry, FInstance* instances, uint32_t count);
+
+// Damage tracking lets an animation redraw only what changed, into a frame
+// buffer or offscreen target that keeps its contents between frames (e.g. a
+// window with a GColorClear background).  fpath_get_bounds gives the canvas
+// pixels that drawing fpath may touch, including AA edges, and
+// fpath_union_bounds joins two rects, ignoring empty ones.  Each context also
+// gathers the bounds of everything it draws, clipped to the target, until
+// fpath_take_drawn returns them and starts over.  A frame clears the union of
+// what was drawn last time and the bounds of what it is about to draw, then
+// draws: the rest of the target is unchanged.
+GRect fpath_get_bounds(FPath* fpath);
+GRect fpath_union_bounds(GRect a, GRect b);
+GRect fpath_take_drawn(FContext* fctx);
+
+#ifdef PBL_COLOR
+// The quality governor holds a context to a frame time budget by giving up
+// anti-aliasing while an animation is too slow for it.  There are three
+// tiers: FQualityAA is the AA renderer, FQualityReducedAA samples 4 subpixel
+// rows per pixel instead of 8, for half the edge work and coverage in
+// quarters, and FQualityBW is the BW renderer.  Call fpath_begin_frame and
+// fpath_end_frame around everything a frame draws with the context.  After
+// FPATH_GOVERNOR_OVERRUNS frames in a row over budget it steps down a tier,
+// and after FPATH_GOVERNOR_SETTLE frames in a row within three quarters of
+// the budget it tries the tier above.  Each step up that has to be taken
+// back doubles the wait for the next one, so a scene that sits between two
+// tiers settles on the lower one.  Once the scene is static (animating is
+// false) time no longer matters: the context goes straight back to full AA.
+// fpath_end_frame returns true when the tier changed, to redraw a static
+// frame at full quality, and because masks take the format of the renderer
+// that made them.  A budget of 0, the default, turns the governor off.
+// fpath_set_quality changes tier by hand, and returns false, keeping the
+// tier, during a fill or if the flag buffer for the new tier can't be had.
+#define FPATH_GOVERNOR_OVERRUNS 2
+#define FPATH_GOVERNOR_SETTLE 16
+
+typedef enum FQuality {
+	FQualityBW,
+	FQualityReducedAA,
+	FQualityAA
+} FQuality;
+
+FQuality fpath_get_quality(FContext* fctx);
+bool fpath_set_quality(FContext* fctx, FQuality quality);
+void fpath_set_frame_budget(FContext* fctx, uint16_t budget_ms);
+void fpath_begin_frame(FContext* fctx);
+bool fpath_end_frame(FContext* fctx, bool animating);
+#endif
 
-extern fpath_init_context_func fpath_init_context;
-extern fpath_begin_fill_func fpath_begin_fill;
-extern fpath_draw_filled_func fpath_draw_filled;
-extern fpath_end_fill_func fpath_end_fill;
-extern fpath_deinit_context_func fpath_deinit_context;
+// fpath_set_origin places the target at origin on a larger canvas, so that
+// paths (and masks) are drawn in canvas coordinates and only the part that
+// falls on the target is rendered.  A canvas can be split into tiles, each
+// with its own bitmap context, and the tiles come out bit-identical to the
+// same region of a single full-size render.  Tiles can be rendered
+// concurrently once each context has private flags (equal-size tiles
+// would otherwise share a buffer), as long as no contexts are initialized
+// or deinitialized meanwhile.
+void fpath_set_origin(FContext* fctx, GPoint origin);
@@ -62,8 +62,9 @@ bool bezier_fixed(FPathBuilder* builder, FPoint p1, FPoint p2, FPoint p3, FPoint
 
 FPathBuilder* fpath_builder_create(uint32_t max_points) {
   // Allocate enough memory to store all the points - points are stored contiguously with the
-  // FPathBuilder structure
-  const size_t required_size = sizeof(FPathBuilder) + max_points * sizeof(FPoint);
+  // FPathBuilder structure, followed by the contour table.  Every contour has at least one
+  // point, so there can be no more contours than points.
+  const size_t required_size = sizeof(FPathBuilder) + max_points * (sizeof(FPoint) + sizeof(uint32_t));
   FPathBuilder* result = malloc(required_size);
 
   if (!result) {
@@ -72,6 +73,7 @@ FPathBuilder* fpath_builder_create(uint32_t max_points) {
 
   memset(result, 0, required_size);
   result->max_points = max_points;
+  result->contours = (uint32_t*)(result->points + max_points);
   return result;
 }
 
@@ -79,22 +81,43 @@ void fpath_builder_destroy(FPathBuilder* builder) {
   free(builder);
 }
 
+// Index of the first point of contour c.  Points added without a move make up a single
+// contour starting at 0.
+static uint32_t contour_start(FPathBuilder* builder, uint32_t c) {
+  return builder->num_contours ? builder->contours[c] : 0;
+}
+
+// Index one past the last point of contour c, leaving out closing points that repeat the
+// contour's own starting point.
+static uint32_t contour_end(FPathBuilder* builder, uint32_t c) {
+  uint32_t start = contour_start(builder, c);
+  uint32_t end = c + 1 < builder->num_contours ? builder->contours[c + 1] : builder->num_points;
+  while (end - start > 1 && fpoint_equal(&builder->points[start], &builder->points[end - 1])) {
+    end--;
+  }
+  return end;
+}
+
 FPath* fpath_builder_create_path(FPathBuilder* builder) {
   if (builder->num_points <= 1) {
     return NULL;
   }
 
-  uint32_t num_points = builder->num_points;
-
-  // handle case where last point == first point => remove last point
-  while (num_points > 1 && fpoint_equal(&builder->points[0], &builder->points[num_points])) {
-    num_points--;
+  // handle case where last point == first point => remove last point, for each contour
+  uint32_t count = builder->num_contours ? builder->num_contours : 1;
+  uint32_t num_points = 0;
+  for (uint32_t c = 0; c < count; ++c) {
+    num_points += contour_end(builder, c) - contour_start(builder, c);
   }
 
-  // Allocate enough memory for both the FPath structure as well as the array of FPoints.
-  // Both will be contiguous in memory.
+  // A single contour doesn't need a table.
+  uint32_t num_contours = count > 1 ? count : 0;
+
+  // Allocate enough memory for the FPath structure, the array of FPoints and the contour
+  // table.  All will be contiguous in memory.
   const size_t size_of_points = num_points * sizeof(FPoint);
-  FPath *result = malloc(sizeof(FPath) + size_of_points);
+  const size_t size_of_contours = num_contours * sizeof(uint32_t);
+  FPath *result = malloc(sizeof(FPath) + size_of_points + size_of_contours);
 
   if (!result) {
     return NULL;
@@ -105,7 +128,34 @@ FPath* fpath_builder_create_path(FPathBuilder* builder) {
   // Set the points pointer within the FPath structure to point just after the FPath structure
   // since that is where memory has been allocated for the array.
   result->points = (FPoint*)(result + 1);
-  memcpy(result->points, builder->points, size_of_points);
+  result->num_contours = 1;
+  if (num_contours) {
+    result->num_contours = num_contours;
+    result->contours = (uint32_t*)(result->points + num_points);
+  }
+  // Copy the contours one after another, moving each start down past the points trimmed
+  // from the contours before it.
+  uint32_t k = 0;
+  for (uint32_t c = 0; c < count; ++c) {
+    uint32_t start = contour_start(builder, c);
+    uint32_t end = contour_end(builder, c);
+    if (num_contours) {
+      result->contours[c] = k;
+    }
+    memcpy(result->points + k, builder->points + start, (end - start) * sizeof(FPoint));
+    k += end - start;
+  }
+  return result;
+}
+
+FPath16* fpath_builder_create_path16(FPathBuilder* builder) {
+  // Trim the contours as for an FPath, then narrow the points.
+  FPath* path = fpath_builder_create_path(builder);
+  if (!path) {
+    return NULL;
+  }
+  FPath16* result = fpath_create_path16(path);
+  fpath_destroy(path);
   return result;
 }
 
@@ -114,12 +164,9 @@ GPath* fpath_builder_create_gpath(FPathBuilder* builder) {
     return NULL;
   }
 
-  uint32_t num_points = builder->num_points;
-
-  // handle case where last point == first point => remove last point
-  while (num_points > 1 && fpoint_equal(&builder->points[0], &builder->points[num_points])) {
-    num_points--;
-  }
+  // A GPath has a single contour, so only the first one is kept.  The last point is
+  // removed while it is the same as the first.
+  uint32_t num_points = contour_end(builder, 0);
 
   // Allocate enough memory for both the FPath structure as well as the array of FPoints.
   // Both will be contiguous in memory.
@@ -143,11 +190,22 @@ GPath* fpath_builder_create_gpath(FPathBuilder* builder) {
 }
 
 bool fpath_builder_move_to_point(FPathBuilder* builder, FPoint to_point) {
-  if (builder->num_points != 0) {
+  if (builder->num_contours == 0 && builder->num_points > 0) {
+    // points were added without a move, they make up the first contour
+    builder->contours[builder->num_contours++] = 0;
+  } else if (builder->num_contours > 0 &&
+      builder->contours[builder->num_contours - 1] == builder->num_points - 1) {
+    // the current contour is just a starting point, so move it instead
+    builder->points[builder->num_points - 1] = to_point;
+    return true;
+  }
+
+  if (!fpath_builder_line_to_point(builder, to_point)) {
     return false;
   }
 
-  return fpath_builder_line_to_point(builder, to_point);
+  builder->contours[builder->num_contours++] = builder->num_points - 1;
+  return true;
 }
 
 bool fpath_builder_line_to_point(FPathBuilder* builder, FPoint to_point) {
@@ -47,6 +47,10 @@ typedef struct {
     uint32_t max_points;
     //! The number of points in `points` array
     uint32_t num_points;
+    //! The number of contours started with fpath_builder_move_to_point()
+    uint32_t num_contours;
+    //! Index of the first point of each contour, stored after `points`
+    uint32_t* contours;
     //! Array containing points
     FPoint points[];
 } FPathBuilder;
@@ -61,11 +65,13 @@ FPathBuilder* fpath_builder_create(uint32_t max_points);
 //! Destroys FPathBuilder previously created with fpath_builder_create()
 void fpath_builder_destroy(FPathBuilder* builder);
 
-//! Sets starting point for FPath
+//! Starts a new contour at the point given.  The first call sets the starting point
+//! for the FPath; later calls close the current contour and begin another one, so that
+//! shapes with holes can be built as a single FPath.
 //! @param builder FPathBuilder object to manipulate on
-//! @param to_point starting point for the FPath
+//! @param to_point starting point for the contour
 //! @return True if point was moved successfully False if there was no space in
-//! FPathBuilder struct or there was segment added already
+//! FPathBuilder struct
 bool fpath_builder_move_to_point(FPathBuilder* builder, FPoint to_point);
 
 //! Makes straight line from current point to point given and makes it new current point
@@ -87,16 +93,29 @@ bool fpath_builder_curve_to_point(FPathBuilder* builder, FPoint to_point,
 //! Creates a new FPath on the heap based on a data from FPathBuilder
 //!
 //! Values after initialization:
-//! * `num_points` and `points` pointer: copied from the FPathBuilder
+//! * `num_points` and `points` pointer: copied from the FPathBuilder, without the closing
+//!   points at the end of each contour that repeat its starting point
+//! * `num_contours` and `contours` pointer: copied from the FPathBuilder and moved down
+//!   past the dropped points, `contours` is `NULL` when there is only one contour
 //! * `rotation`: 0
 //! * `offset`: (0, 0)
 //! @return A pointer to the FPath. `NULL` if num_points less than 2 or not enough memory
 FPath* fpath_builder_create_path(FPathBuilder* builder);
 
+//! Creates a new FPath16 on the heap based on a data from FPathBuilder, with the points
+//! stored in 16 bits, at half the size of an FPath
+//!
+//! Values after initialization are the same as for fpath_builder_create_path()
+//! @return A pointer to the FPath16. `NULL` if num_points less than 2, a point is more than
+//! 2047 pixels from (0, 0) or not enough memory
+FPath16* fpath_builder_create_path16(FPathBuilder* builder);
+
 //! Creates a new GPath on the heap based on a data from FPathBuilder
+//! @note GPath has no notion of holes, so only the first contour is used
 //!
 //! Values after initialization:
-//! * `num_points` and `points` pointer: copied from the FPathBuilder
+//! * `num_points` and `points` pointer: copied from the first contour of the FPathBuilder,
+//!   without the closing points that repeat its starting point
 //! * `rotation`: 0
 //! * `offset`: (0, 0)
 //! @return A pointer to the GPath. `NULL` if num_points less than 2 or not enough memory
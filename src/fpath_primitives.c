@@ -0,0 +1,175 @@
+#include "fpath_primitives.h"
+
+// The angle between neighbouring entries of the unit circle table.
+#define CIRCLE_STEP_ANGLE (TRIG_MAX_ANGLE / FPATH_CIRCLE_MAX_POINTS)
+#define QUARTER (FPATH_CIRCLE_MAX_POINTS / 4)
+
+// The sine of the first quarter turn, mirrored for the other three.  It's
+// filled on first use and then shared by every primitive.
+static int32_t s_quarter_sine[QUARTER + 1];
+static bool s_quarter_sine_ready = false;
+
+int32_t circle_table_sine(int32_t index) {
+  if (!s_quarter_sine_ready) {
+    for (int32_t k = 0; k <= QUARTER; ++k) {
+      s_quarter_sine[k] = sin_lookup(k * CIRCLE_STEP_ANGLE);
+    }
+    s_quarter_sine_ready = true;
+  }
+  index &= FPATH_CIRCLE_MAX_POINTS - 1;
+  int32_t k = index % QUARTER;
+  switch (index / QUARTER) {
+  case 0:
+    return s_quarter_sine[k];
+  case 1:
+    return s_quarter_sine[QUARTER - k];
+  case 2:
+    return -s_quarter_sine[k];
+  default:
+    return -s_quarter_sine[QUARTER - k];
+  }
+}
+
+// Angles run clockwise from 12 o'clock, so y is up by the cosine.  The products
+// are 64 bit: a radius over 2047 px times TRIG_MAX_RATIO doesn't fit in 32.
+FPoint circle_point(int32_t sine, int32_t cosine, fixed_t radius_x, fixed_t radius_y, FPoint center) {
+  return FPoint(center.x + (fixed_t)((int64_t)radius_x * sine / TRIG_MAX_RATIO),
+                center.y - (fixed_t)((int64_t)radius_y * cosine / TRIG_MAX_RATIO));
+}
+
+FPoint circle_table_point(int32_t index, fixed_t radius_x, fixed_t radius_y, FPoint center) {
+  return circle_point(circle_table_sine(index), circle_table_sine(index + QUARTER), radius_x, radius_y, center);
+}
+
+FPoint circle_angle_point(int32_t angle, fixed_t radius, FPoint center) {
+  return circle_point(sin_lookup(angle), cos_lookup(angle), radius, radius, center);
+}
+
+bool primitive_fail(FPath* path) {
+  path->num_points = 0;
+  return false;
+}
+
+void primitive_set_points(FPath* path, uint32_t num_points) {
+  path->num_points = num_points;
+  path->num_contours = 0;
+  path->contours = NULL;
+}
+
+uint32_t fpath_circle_point_count(fixed_t radius) {
+  // The widest gap between an n-gon and its circle is r (1 - cos(pi / n)).
+  uint32_t n = 8;
+  while (n < FPATH_CIRCLE_MAX_POINTS &&
+         radius - (int64_t)radius * cos_lookup(TRIG_MAX_ANGLE / (2 * n)) / TRIG_MAX_RATIO > FPATH_PRIMITIVE_TOLERANCE) {
+    n *= 2;
+  }
+  return n;
+}
+
+bool fpath_make_ellipse(FPath* path, uint32_t max_points, fixed_t radius_x, fixed_t radius_y) {
+  uint32_t n = fpath_circle_point_count(radius_x > radius_y ? radius_x : radius_y);
+  if (n > max_points) {
+    return primitive_fail(path);
+  }
+  int32_t step = FPATH_CIRCLE_MAX_POINTS / n;
+  for (uint32_t k = 0; k < n; ++k) {
+    path->points[k] = circle_table_point(k * step, radius_x, radius_y, FPointZero);
+  }
+  primitive_set_points(path, n);
+  return true;
+}
+
+bool fpath_make_circle(FPath* path, uint32_t max_points, fixed_t radius) {
+  return fpath_make_ellipse(path, max_points, radius, radius);
+}
+
+// Adds the points of an arc from angle_start to angle_end, or the other way
+// when reverse is set: the exact ends, and the table points between them.
+bool add_arc_points(FPath* path, uint32_t max_points, uint32_t* count, fixed_t radius,
+                    int32_t angle_start, int32_t angle_end, bool reverse) {
+  int32_t step = FPATH_CIRCLE_MAX_POINTS / fpath_circle_point_count(radius);
+  int32_t step_angle = step * CIRCLE_STEP_ANGLE;
+  // the multiples of step_angle strictly between the ends.
+  int32_t first = (angle_start >= 0 ? angle_start / step_angle : -((-angle_start + step_angle - 1) / step_angle)) + 1;
+  int32_t last = (angle_end > 0 ? (angle_end + step_angle - 1) / step_angle : -(-angle_end / step_angle)) - 1;
+  uint32_t n = 2 + (last >= first ? last - first + 1 : 0);
+  if (*count + n > max_points) {
+    return false;
+  }
+
+  FPoint* p = path->points + *count;
+  *p++ = circle_angle_point(reverse ? angle_end : angle_start, radius, FPointZero);
+  for (int32_t k = first; k <= last; ++k) {
+    *p++ = circle_table_point((reverse ? last - (k - first) : k) * step, radius, radius, FPointZero);
+  }
+  *p++ = circle_angle_point(reverse ? angle_start : angle_end, radius, FPointZero);
+  *count += n;
+  return true;
+}
+
+bool fpath_make_arc(FPath* path, uint32_t max_points, fixed_t radius, fixed_t inner_radius,
+                    int32_t angle_start, int32_t angle_end) {
+  if (angle_end - angle_start > TRIG_MAX_ANGLE) {
+    angle_end = angle_start + TRIG_MAX_ANGLE;
+  }
+
+  // A whole ring is one contour too: the two edges along the seam cancel.
+  uint32_t count = 0;
+  if (!add_arc_points(path, max_points, &count, radius, angle_start, angle_end, false)) {
+    return primitive_fail(path);
+  }
+  if (inner_radius > 0) {
+    if (!add_arc_points(path, max_points, &count, inner_radius, angle_start, angle_end, true)) {
+      return primitive_fail(path);
+    }
+  } else {
+    if (count + 1 > max_points) {
+      return primitive_fail(path);
+    }
+    path->points[count++] = FPointZero;
+  }
+  primitive_set_points(path, count);
+  return true;
+}
+
+bool fpath_make_rounded_rect(FPath* path, uint32_t max_points, FSize size, fixed_t corner_radius) {
+  fixed_t half_w = size.w / 2;
+  fixed_t half_h = size.h / 2;
+  fixed_t r = corner_radius;
+  if (r > half_w) r = half_w;
+  if (r > half_h) r = half_h;
+
+  if (r <= 0) {
+    if (max_points < 4) {
+      return primitive_fail(path);
+    }
+    path->points[0] = FPoint( half_w, -half_h);
+    path->points[1] = FPoint( half_w,  half_h);
+    path->points[2] = FPoint(-half_w,  half_h);
+    path->points[3] = FPoint(-half_w, -half_h);
+    primitive_set_points(path, 4);
+    return true;
+  }
+
+  // A quarter of the circle for each corner, clockwise from the top right.
+  uint32_t n = fpath_circle_point_count(r);
+  uint32_t per_corner = n / 4 + 1;
+  if (4 * per_corner > max_points) {
+    return primitive_fail(path);
+  }
+  const FPoint centers[4] = {
+    FPoint( half_w - r, -half_h + r),
+    FPoint( half_w - r,  half_h - r),
+    FPoint(-half_w + r,  half_h - r),
+    FPoint(-half_w + r, -half_h + r),
+  };
+  int32_t step = FPATH_CIRCLE_MAX_POINTS / n;
+  FPoint* p = path->points;
+  for (int32_t c = 0; c < 4; ++c) {
+    for (uint32_t k = 0; k < per_corner; ++k) {
+      *p++ = circle_table_point(c * QUARTER + k * step, r, r, centers[c]);
+    }
+  }
+  primitive_set_points(path, 4 * per_corner);
+  return true;
+}
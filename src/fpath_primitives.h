@@ -0,0 +1,86 @@
+
+#pragma once
+#include <pebble.h>
+#include "fpath.h"
+
+//! @addtogroup Graphics
+//! @{
+//!   @addtogroup PathPrimitives Path Primitives
+//! \brief Functions to fill an FPath with a circle, ellipse, arc or rounded rectangle
+//!
+//! The shapes are centered on (0, 0), so that fpath_move_to() places them and
+//! fpath_rotate_to() turns them about their center.  Curves are made of as many points as
+//! the radius needs to stay within FPATH_PRIMITIVE_TOLERANCE of the true curve, rounded up
+//! to a power of two, and taken from one table of the unit circle shared by all calls.
+//! Nothing is allocated: the FPath's `points` must already point to `max_points` FPoints,
+//! and only `num_points`, `num_contours` and `contours` are changed, so a shape can be
+//! rebuilt in place whenever its size changes.
+//!
+//! The points are computed with 64 bit products, so larger radii don't overflow while the
+//! shape is made.  To be drawn, though, a path must lie within 2047 pixels of (0, 0) before
+//! its offset is applied, which limits radii, and half the size of a rounded rectangle, to
+//! 2047 pixels.
+//!
+//! Code example:
+//! \code{.c}
+//! static FPoint s_ring_points[FPATH_CIRCLE_MAX_POINTS * 2 + 4];
+//! static FPath s_ring = { .points = s_ring_points };
+//!
+//! void update_ring(int32_t progress_angle) {
+//!   fpath_make_arc(&s_ring, ARRAY_LENGTH(s_ring_points), INT_TO_FIXED(60), INT_TO_FIXED(50),
+//!                  0, progress_angle);
+//!   fpath_move_to(&s_ring, FPointI(72, 84));
+//! }
+//! \endcode
+//!   @{
+
+//! Largest distance, in fixed point units, allowed between a curve and its points
+#define FPATH_PRIMITIVE_TOLERANCE (FIXED_POINT_SCALE / 8)
+
+//! Most points used for a whole circle, and the size of the unit circle table
+#define FPATH_CIRCLE_MAX_POINTS 256
+
+//! The number of points used for a whole circle of the given radius
+//! @param radius radius in fixed point units
+//! @return A power of two from 8 to FPATH_CIRCLE_MAX_POINTS
+uint32_t fpath_circle_point_count(fixed_t radius);
+
+//! Fills a path with a circle
+//! @param path FPath to fill, with room for fpath_circle_point_count(radius) points
+//! @param max_points Size of the path's `points` array
+//! @param radius radius in fixed point units
+//! @return True if the circle was made, False (and an empty path) if there was no space
+bool fpath_make_circle(FPath* path, uint32_t max_points, fixed_t radius);
+
+//! Fills a path with an ellipse
+//! @param path FPath to fill, with room for fpath_circle_point_count() of the larger radius
+//! @param max_points Size of the path's `points` array
+//! @param radius_x horizontal radius in fixed point units
+//! @param radius_y vertical radius in fixed point units
+//! @return True if the ellipse was made, False (and an empty path) if there was no space
+bool fpath_make_ellipse(FPath* path, uint32_t max_points, fixed_t radius_x, fixed_t radius_y);
+
+//! Fills a path with a ring segment between two radii, or a pie slice when inner_radius
+//! is 0.  Angles are measured clockwise from 12 o'clock, like graphics_fill_radial(), and
+//! an arc of TRIG_MAX_ANGLE or more makes a whole ring.
+//! @param path FPath to fill, with room for the point counts of both radii plus 4
+//! @param max_points Size of the path's `points` array
+//! @param radius outer radius in fixed point units
+//! @param inner_radius inner radius in fixed point units, 0 for a pie slice
+//! @param angle_start starting angle
+//! @param angle_end ending angle, not less than angle_start
+//! @return True if the arc was made, False (and an empty path) if there was no space
+bool fpath_make_arc(FPath* path, uint32_t max_points, fixed_t radius, fixed_t inner_radius,
+                    int32_t angle_start, int32_t angle_end);
+
+//! Fills a path with a rectangle with rounded corners.  The corner radius is limited to
+//! half the smaller side, and a radius of 0 gives square corners.
+//! @param path FPath to fill, with room for fpath_circle_point_count(corner_radius) plus 4
+//! @param max_points Size of the path's `points` array
+//! @param size width and height in fixed point units
+//! @param corner_radius radius of the corners in fixed point units
+//! @return True if the rectangle was made, False (and an empty path) if there was no space
+bool fpath_make_rounded_rect(FPath* path, uint32_t max_points, FSize size, fixed_t corner_radius);
+
+//!   @} // end addtogroup PathPrimitives
+//! @} // end addtogroup Graphics
@@ -0,0 +1,589 @@
+// Host regression check for the rasterizers.
+//
+// Each test path is rendered over a sweep of rotations and subpixel offsets
+// by every renderer into a coverage mask, and compared pixel by pixel with
+// the exact even-odd area of the path inside each pixel.  The max, mean and
+// signed error say how good a renderer is; a checksum of every mask it
+// rendered, checked against the golden file, says whether a change to the
+// library changed its output at all.  Each fill is also drawn straight into
+// a target and compared with stamping its mask, and filled again a few edges
+// and rows at a time with the step functions, so the direct, mask and stepped
+// paths of a renderer can't drift apart.
+//
+//   accuracy [--update] [--dump DIR] GOLDEN
+//
+// --update rewrites GOLDEN with the checksums of this run instead of checking
+// them.  --dump writes the first render of each path and renderer to DIR as a
+// PGM of its coverage, with a PGM of the reference and a PPM of the error (red
+// where the renderer covers too much, blue where too little).
+#include <pebble.h>
+#include <math.h>
+#include "fpath_builder.h"
+#include "fpath_primitives.h"
+
+#define ROTATIONS 24
+#define OFFSETS 4
+#define MAX_POINTS 256
+#define MAX_GOLDEN 64
+
+typedef enum {
+  RENDERER_BW,
+#ifdef PBL_COLOR
+  RENDERER_AA,
+  RENDERER_REDUCED,
+  RENDERER_AREA,
+#endif
+  RENDERER_COUNT
+} Renderer;
+
+static const char *s_renderer_names[] = {
+  "bw",
+#ifdef PBL_COLOR
+  "aa",
+  "reduced",
+  "area",
+#endif
+};
+
+typedef struct {
+  const char *name;
+  FPath *path;
+} TestPath;
+
+typedef struct {
+  char path[16];
+  char renderer[16];
+  uint32_t checksum;
+} Golden;
+
+// --------------------------------------------------------------------------
+// Test paths: the demo's paths, and a few that are hard to get right.
+// --------------------------------------------------------------------------
+
+static FPath *prv_finish(FPathBuilder *builder) {
+  FPath *path = fpath_builder_create_path(builder);
+  fpath_builder_destroy(builder);
+  return path;
+}
+
+static FPath *prv_copy_points(FPath *source) {
+  FPathBuilder *builder = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point(builder, source->points[0]);
+  for (uint32_t k = 1; k < source->num_points; ++k) {
+    fpath_builder_line_to_point(builder, source->points[k]);
+  }
+  return prv_finish(builder);
+}
+
+static int prv_build_paths(TestPath *paths) {
+  static FPoint points[MAX_POINTS];
+  FPath primitive = { .points = points };
+  FPathBuilder *b;
+  int n = 0;
+
+  b = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point (b, FPointI(-15, -15));
+  fpath_builder_curve_to_point(b, FPointI( 15, -15), FPointI(-15, -60), FPointI( 15, -60));
+  fpath_builder_curve_to_point(b, FPointI( 15,  15), FPointI( 60, -15), FPointI( 60,  15));
+  fpath_builder_curve_to_point(b, FPointI(-15,  15), FPointI( 15,  60), FPointI(-15,  60));
+  fpath_builder_curve_to_point(b, FPointI(-15, -15), FPointI(-60,  15), FPointI(-60, -15));
+  paths[n++] = (TestPath){ "petals", prv_finish(b) };
+
+  b = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point (b, FPointI(-20, -50));
+  fpath_builder_curve_to_point(b, FPointI( 20, -50), FPointI(-25, -60), FPointI( 25, -60));
+  fpath_builder_curve_to_point(b, FPointI( 20,  50), FPointI(  0,   0), FPointI(  0,   0));
+  fpath_builder_curve_to_point(b, FPointI(-20,  50), FPointI( 25,  60), FPointI(-25,  60));
+  fpath_builder_curve_to_point(b, FPointI(-20, -50), FPointI(  0,   0), FPointI(  0,   0));
+  paths[n++] = (TestPath){ "bone", prv_finish(b) };
+
+  b = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point (b, FPointI(  0, -60));
+  fpath_builder_curve_to_point(b, FPointI( 60,   0), FPointI( 35, -60), FPointI( 60, -35));
+  fpath_builder_curve_to_point(b, FPointI(  0,  60), FPointI( 60,  35), FPointI( 35,  60));
+  fpath_builder_curve_to_point(b, FPointI(  0,   0), FPointI(-50,  60), FPointI(-50,   0));
+  fpath_builder_curve_to_point(b, FPointI(  0, -60), FPointI( 50,   0), FPointI( 50, -60));
+  paths[n++] = (TestPath){ "swirl", prv_finish(b) };
+
+  b = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point (b, FPointI(  0, -60));
+  fpath_builder_curve_to_point(b, FPointI( 60,   0), FPointI( 35, -60), FPointI( 60, -35));
+  fpath_builder_line_to_point (b, FPointI(-60,   0));
+  fpath_builder_curve_to_point(b, FPointI(  0,  60), FPointI(-60,  35), FPointI(-35,  60));
+  fpath_builder_line_to_point (b, FPointI(  0, -60));
+  paths[n++] = (TestPath){ "wedges", prv_finish(b) };
+
+  b = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point (b, FPointI(  0, -60));
+  fpath_builder_curve_to_point(b, FPointI( 60,   0), FPointI( 33, -60), FPointI( 60, -33));
+  fpath_builder_curve_to_point(b, FPointI(  0,  60), FPointI( 60,  33), FPointI( 33,  60));
+  fpath_builder_curve_to_point(b, FPointI(-60,   0), FPointI(-33,  60), FPointI(-60,  33));
+  fpath_builder_curve_to_point(b, FPointI(  0, -60), FPointI(-60, -33), FPointI(-33, -60));
+  fpath_builder_move_to_point (b, FPointI(-25, -25));
+  fpath_builder_line_to_point (b, FPointI( 25, -25));
+  fpath_builder_line_to_point (b, FPointI( 25,  25));
+  fpath_builder_line_to_point (b, FPointI(-25,  25));
+  // both contours end on their own start, which the builder drops.
+  fpath_builder_line_to_point (b, FPointI(-25, -25));
+  paths[n++] = (TestPath){ "window", prv_finish(b) };
+
+  fpath_make_arc(&primitive, MAX_POINTS, INT_TO_FIXED(60), INT_TO_FIXED(40), 0, TRIG_MAX_ANGLE * 3 / 4);
+  paths[n++] = (TestPath){ "ring", prv_copy_points(&primitive) };
+
+  // a pentagram crosses itself, so its middle is a hole.
+  b = fpath_builder_create(MAX_POINTS);
+  for (int k = 0; k < 5; ++k) {
+    int32_t angle = k * 2 * TRIG_MAX_ANGLE / 5;
+    FPoint p = FPoint(50 * 16 * sin_lookup(angle) / TRIG_MAX_RATIO, -50 * 16 * cos_lookup(angle) / TRIG_MAX_RATIO);
+    if (k) {
+      fpath_builder_line_to_point(b, p);
+    } else {
+      fpath_builder_move_to_point(b, p);
+    }
+  }
+  paths[n++] = (TestPath){ "star", prv_finish(b) };
+
+  b = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point(b, FPoint(-800, -24));
+  fpath_builder_line_to_point(b, FPoint( 800,   0));
+  fpath_builder_line_to_point(b, FPoint(-800,  40));
+  paths[n++] = (TestPath){ "sliver", prv_finish(b) };
+
+  // wider than 128 pixels at most rotations, so the flags are resolved a
+  // whole vector register at a time.
+  b = fpath_builder_create(MAX_POINTS);
+  fpath_builder_move_to_point (b, FPointI(-140, -10));
+  fpath_builder_curve_to_point(b, FPointI( 140, -10), FPointI(-50, -40), FPointI( 50,  20));
+  fpath_builder_line_to_point (b, FPointI( 140,  10));
+  fpath_builder_curve_to_point(b, FPointI(-140,  10), FPointI( 50,  40), FPointI(-50, -20));
+  paths[n++] = (TestPath){ "band", prv_finish(b) };
+
+  fpath_make_circle(&primitive, MAX_POINTS, INT_TO_FIXED(5) / 2);
+  paths[n++] = (TestPath){ "dot", prv_copy_points(&primitive) };
+
+  return n;
+}
+
+// Distance from the path origin to its farthest point, in fixed point.
+static int32_t prv_path_radius(FPath *path) {
+  double radius = 0;
+  for (uint32_t k = 0; k < path->num_points; ++k) {
+    double r = hypot(path->points[k].x, path->points[k].y);
+    if (r > radius) radius = r;
+  }
+  return (int32_t)ceil(radius);
+}
+
+// --------------------------------------------------------------------------
+// Exact reference coverage.
+// --------------------------------------------------------------------------
+
+typedef struct {
+  double x0, y0, x1, y1;
+} Segment;
+
+typedef struct {
+  double xa, xb, xm; // x at the top, bottom and middle of a band
+} Crossing;
+
+// Transforms the path the way the rasterizer does, without its sampling adjustment.
+static void prv_transform(FPath *path, FPoint *points) {
+  int32_t c = cos_lookup(path->rotation);
+  int32_t s = sin_lookup(path->rotation);
+  for (uint32_t k = 0; k < path->num_points; ++k) {
+    FPoint p = path->points[k];
+    points[k].x = (p.x * c / TRIG_MAX_RATIO) - (p.y * s / TRIG_MAX_RATIO) + path->offset.x;
+    points[k].y = (p.x * s / TRIG_MAX_RATIO) + (p.y * c / TRIG_MAX_RATIO) + path->offset.y;
+  }
+}
+
+static int prv_compare_doubles(const void *a, const void *b) {
+  double d = *(const double *)a - *(const double *)b;
+  return d < 0 ? -1 : d > 0;
+}
+
+static int prv_compare_crossings(const void *a, const void *b) {
+  double d = ((const Crossing *)a)->xm - ((const Crossing *)b)->xm;
+  return d < 0 ? -1 : d > 0;
+}
+
+// The mean over t in [0, 1] of clamp(a + t (b - a), 0, 1).
+static double prv_mean_clamp(double a, double b) {
+  #define RAMP_INTEGRAL(u) ((u) <= 0 ? 0 : (u) >= 1 ? (u) - 0.5 : (u) * (u) / 2)
+  if (fabs(b - a) < 1e-12) {
+    double m = (a + b) / 2;
+    return m <= 0 ? 0 : m >= 1 ? 1 : m;
+  }
+  return (RAMP_INTEGRAL(b) - RAMP_INTEGRAL(a)) / (b - a);
+  #undef RAMP_INTEGRAL
+}
+
+// The even-odd area of the path inside each pixel of a size by size grid.
+// The plane is cut into bands at every vertex, every crossing of two edges
+// and every pixel row, so that within a band the same edges cross it in the
+// same order and each run between a pair of them is a trapezoid, whose area
+// in each pixel column is integrated exactly.
+static void prv_reference(FPath *path, FPoint *points, int size, double *coverage) {
+  uint32_t num_contours = path->contours ? path->num_contours : 1;
+  uint32_t n = path->num_points;
+  Segment *segments = malloc(n * sizeof(Segment));
+  Crossing *crossings = malloc(n * sizeof(Crossing));
+  uint32_t max_ys = n + n * n / 2 + size + 1;
+  double *ys = malloc(max_ys * sizeof(double));
+  uint32_t num_segments = 0, num_ys = 0;
+
+  for (uint32_t c = 0; c < num_contours; ++c) {
+    uint32_t first = path->contours ? path->contours[c] : 0;
+    uint32_t last = c + 1 < num_contours ? path->contours[c + 1] : n;
+    for (uint32_t k = first; k < last; ++k) {
+      FPoint a = points[k];
+      FPoint b = points[k + 1 < last ? k + 1 : first];
+      if (a.y == b.y) continue;
+      segments[num_segments++] = (Segment){ a.x / 16.0, a.y / 16.0, b.x / 16.0, b.y / 16.0 };
+      ys[num_ys++] = a.y / 16.0;
+    }
+  }
+  for (int y = 0; y <= size; ++y) {
+    ys[num_ys++] = y;
+  }
+  for (uint32_t i = 0; i < num_segments; ++i) {
+    Segment *p = segments + i;
+    for (uint32_t j = i + 1; j < num_segments && num_ys < max_ys; ++j) {
+      Segment *q = segments + j;
+      double rx = p->x1 - p->x0, ry = p->y1 - p->y0;
+      double sx = q->x1 - q->x0, sy = q->y1 - q->y0;
+      double denominator = rx * sy - ry * sx;
+      if (fabs(denominator) < 1e-12) continue;
+      double t = ((q->x0 - p->x0) * sy - (q->y0 - p->y0) * sx) / denominator;
+      double u = ((q->x0 - p->x0) * ry - (q->y0 - p->y0) * rx) / denominator;
+      if (t > 0 && t < 1 && u > 0 && u < 1) {
+        ys[num_ys++] = p->y0 + t * ry;
+      }
+    }
+  }
+  qsort(ys, num_ys, sizeof(double), prv_compare_doubles);
+
+  memset(coverage, 0, size * size * sizeof(double));
+  for (uint32_t k = 0; k + 1 < num_ys; ++k) {
+    double ya = ys[k], yb = ys[k + 1], h = yb - ya;
+    double ym = (ya + yb) / 2;
+    int row = (int)floor(ym);
+    if (h < 1e-9 || row < 0 || row >= size) continue;
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < num_segments; ++i) {
+      Segment *s = segments + i;
+      if ((s->y0 < ym) == (s->y1 < ym)) continue;
+      double slope = (s->x1 - s->x0) / (s->y1 - s->y0);
+      crossings[count++] = (Crossing){ s->x0 + (ya - s->y0) * slope, s->x0 + (yb - s->y0) * slope,
+                                       s->x0 + (ym - s->y0) * slope };
+    }
+    qsort(crossings, count, sizeof(Crossing), prv_compare_crossings);
+
+    double *dest = coverage + row * size;
+    for (uint32_t i = 0; i + 1 < count; i += 2) {
+      Crossing *l = crossings + i, *r = crossings + i + 1;
+      int x0 = (int)floor(fmin(l->xa, l->xb));
+      int x1 = (int)floor(fmax(r->xa, r->xb));
+      if (x0 < 0) x0 = 0;
+      if (x1 > size - 1) x1 = size - 1;
+      for (int px = x0; px <= x1; ++px) {
+        dest[px] += h * (prv_mean_clamp(r->xa - px, r->xb - px) - prv_mean_clamp(l->xa - px, l->xb - px));
+      }
+    }
+  }
+
+  free(ys);
+  free(crossings);
+  free(segments);
+}
+
+// --------------------------------------------------------------------------
+// Rendering.
+// --------------------------------------------------------------------------
+
+#ifdef PBL_COLOR
+static void prv_area_span(void *data, int32_t y, int32_t x0, int32_t x1, uint8_t coverage) {
+  GBitmap *mask = data;
+  memset(gbitmap_get_data(mask) + gbitmap_get_bytes_per_row(mask) * y + x0, coverage, x1 - x0);
+}
+#endif
+
+static void prv_clear(GBitmap *bitmap) {
+  GRect bounds = gbitmap_get_bounds(bitmap);
+  memset(gbitmap_get_data(bitmap), 0, gbitmap_get_bytes_per_row(bitmap) * bounds.size.h);
+}
+
+// Renders the path into the mask, and straight into the context's target.
+static void prv_render(FContext *fctx, Renderer renderer, FPath *path, GBitmap *mask) {
+  prv_clear(mask);
+  prv_clear(fctx->target);
+#ifdef PBL_COLOR
+  if (RENDERER_AREA == renderer) {
+    fpath_fill_area_spans(fctx, path, prv_area_span, mask);
+    fpath_fill_area(fctx, path);
+    return;
+  }
+#endif
+  fpath_begin_fill(fctx);
+  fpath_draw_filled(fctx, path);
+  fpath_end_fill_mask(fctx, mask);
+  fpath_begin_fill(fctx);
+  fpath_draw_filled(fctx, path);
+  fpath_end_fill(fctx);
+}
+
+// Whether stamping the mask gives the same target as the direct fill.
+static bool prv_consistent(FContext *fctx, GBitmap *mask, uint8_t *direct) {
+  GBitmap *target = fctx->target;
+  uint32_t bytes = gbitmap_get_bytes_per_row(target) * gbitmap_get_bounds(target).size.h;
+  memcpy(direct, gbitmap_get_data(target), bytes);
+  prv_clear(target);
+  fpath_draw_mask(fctx, mask, GPointZero);
+  return 0 == memcmp(direct, gbitmap_get_data(target), bytes);
+}
+
+// Whether plotting and resolving a few edges and rows at a time gives the
+// same mask as a fill done in one go.
+static bool prv_stepped_matches(FContext *fctx, Renderer renderer, FPath *path, GBitmap *mask,
+                                GBitmap *stepped) {
+#ifdef PBL_COLOR
+  if (RENDERER_AREA == renderer) {
+    return true;
+  }
+#endif
+  fpath_begin_fill(fctx);
+  while (!fpath_draw_filled_step(fctx, path, 3)) {
+  }
+  while (!fpath_end_fill_mask_step(fctx, stepped, 5)) {
+  }
+  uint32_t bytes = gbitmap_get_bytes_per_row(mask) * gbitmap_get_bounds(mask).size.h;
+  return 0 == memcmp(gbitmap_get_data(mask), gbitmap_get_data(stepped), bytes);
+}
+
+static double prv_rendered(GBitmap *mask, int x, int y) {
+  uint8_t *row = gbitmap_get_data(mask) + gbitmap_get_bytes_per_row(mask) * y;
+  if (GBitmapFormat1Bit == gbitmap_get_format(mask)) {
+    return (row[x / 8] >> (x % 8)) & 1;
+  }
+  return row[x] / (double)FPATH_FULL_COVERAGE;
+}
+
+// --------------------------------------------------------------------------
+// Image dumps.
+// --------------------------------------------------------------------------
+
+static void prv_dump(const char *dir, const char *path, const char *what,
+                     int size, double *values, bool error) {
+  char name[256];
+  snprintf(name, sizeof(name), "%s/%s-%s.%s", dir, path, what, error ? "ppm" : "pgm");
+  FILE *f = fopen(name, "wb");
+  if (!f) {
+    fprintf(stderr, "can't write %s\n", name);
+    return;
+  }
+  fprintf(f, "P%d\n%d %d\n255\n", error ? 6 : 5, size, size);
+  for (int k = 0; k < size * size; ++k) {
+    double v = values[k];
+    if (error) {
+      uint8_t over = v > 0 ? (uint8_t)lround(fmin(v, 1) * 255) : 0;
+      uint8_t under = v < 0 ? (uint8_t)lround(fmin(-v, 1) * 255) : 0;
+      fputc(over, f);
+      fputc(0, f);
+      fputc(under, f);
+    } else {
+      fputc((uint8_t)lround(fmax(0, fmin(v, 1)) * 255), f);
+    }
+  }
+  fclose(f);
+}
+
+// --------------------------------------------------------------------------
+// Golden checksums.
+// --------------------------------------------------------------------------
+
+static int prv_read_golden(const char *file, Golden *golden) {
+  FILE *f = fopen(file, "r");
+  if (!f) {
+    return 0;
+  }
+  char line[128];
+  int n = 0;
+  while (n < MAX_GOLDEN && fgets(line, sizeof(line), f)) {
+    if ('#' == line[0]) continue;
+    unsigned int checksum;
+    if (3 == sscanf(line, "%15s %15s %x", golden[n].path, golden[n].renderer, &checksum)) {
+      golden[n++].checksum = checksum;
+    }
+  }
+  fclose(f);
+  return n;
+}
+
+static const Golden *prv_find_golden(const Golden *golden, int n, const char *path, const char *renderer) {
+  for (int k = 0; k < n; ++k) {
+    if (0 == strcmp(golden[k].path, path) && 0 == strcmp(golden[k].renderer, renderer)) {
+      return golden + k;
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  bool update = false;
+  const char *dump_dir = NULL;
+  const char *golden_file = NULL;
+  for (int k = 1; k < argc; ++k) {
+    if (0 == strcmp(argv[k], "--update")) {
+      update = true;
+    } else if (0 == strcmp(argv[k], "--dump") && k + 1 < argc) {
+      dump_dir = argv[++k];
+    } else {
+      golden_file = argv[k];
+    }
+  }
+  if (!golden_file) {
+    fprintf(stderr, "usage: %s [--update] [--dump DIR] GOLDEN\n", argv[0]);
+    return 2;
+  }
+
+  static Golden golden[MAX_GOLDEN];
+  static Golden results[MAX_GOLDEN];
+  int num_golden = update ? 0 : prv_read_golden(golden_file, golden);
+  int num_results = 0;
+  int failures = 0;
+
+  TestPath paths[16];
+  int num_paths = prv_build_paths(paths);
+
+  for (int p = 0; p < num_paths; ++p) {
+    FPath probe = *paths[p].path;
+    int size = 2 * (FIXED_TO_INT(prv_path_radius(&probe)) + 2) + 1;
+    FPoint *points = malloc(probe.num_points * sizeof(FPoint));
+    double *reference = malloc(size * size * sizeof(double));
+    double *image = malloc(size * size * sizeof(double));
+    uint8_t *direct = malloc(size * size);
+
+    for (int r = 0; r < RENDERER_COUNT; ++r) {
+      GBitmapFormat format = RENDERER_BW == r ? GBitmapFormat1Bit : GBitmapFormat8Bit;
+      GBitmap *mask = gbitmap_create_blank(GSize(size, size), format);
+      GBitmap *stepped = gbitmap_create_blank(GSize(size, size), format);
+      GBitmap *target = gbitmap_create_blank(GSize(size, size), format);
+      FContext fctx;
+#ifdef PBL_COLOR
+      if (RENDERER_BW == r) {
+        fpath_init_context_bitmap_bw(&fctx, target);
+      } else {
+        fpath_init_context_bitmap_aa(&fctx, target);
+        if (RENDERER_REDUCED == r) {
+          fpath_set_quality(&fctx, FQualityReducedAA);
+        }
+      }
+#else
+      fpath_init_context_bitmap_bw(&fctx, target);
+#endif
+      fpath_set_stroke_color(&fctx, GColorBlack);
+      fpath_set_fill_color(&fctx, GColorWhite);
+
+      uint16_t row_bytes = GBitmapFormat1Bit == format ? (size + 7) / 8 : size;
+      uint32_t checksum = 2166136261u; // FNV-1a
+      double max_error = 0, total_error = 0, total_bias = 0;
+      uint32_t touched = 0, inconsistent = 0;
+
+      for (int rotation = 0; rotation < ROTATIONS; ++rotation) {
+        probe.rotation = rotation * TRIG_MAX_ANGLE / ROTATIONS;
+        for (int k = 0; k < OFFSETS * OFFSETS; ++k) {
+          probe.offset = FPoint(INT_TO_FIXED(size / 2) + (k % OFFSETS) * FIXED_POINT_SCALE / OFFSETS,
+                                INT_TO_FIXED(size / 2) + (k / OFFSETS) * FIXED_POINT_SCALE / OFFSETS);
+          prv_render(&fctx, r, &probe, mask);
+          if (!prv_consistent(&fctx, mask, direct) ||
+              !prv_stepped_matches(&fctx, r, &probe, mask, stepped)) {
+            ++inconsistent;
+          }
+          prv_transform(&probe, points);
+          prv_reference(&probe, points, size, reference);
+
+          for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+              double rendered = prv_rendered(mask, x, y);
+              double error = rendered - reference[y * size + x];
+              image[y * size + x] = rendered;
+              if (rendered == 0 && reference[y * size + x] < 1e-9) continue;
+              ++touched;
+              total_bias += error;
+              total_error += fabs(error);
+              if (fabs(error) > max_error) max_error = fabs(error);
+            }
+            uint8_t *row = gbitmap_get_data(mask) + gbitmap_get_bytes_per_row(mask) * y;
+            for (int b = 0; b < row_bytes; ++b) {
+              checksum = (checksum ^ row[b]) * 16777619u;
+            }
+          }
+
+          if (dump_dir && 0 == rotation && 0 == k) {
+            prv_dump(dump_dir, paths[p].name, s_renderer_names[r], size, image, false);
+            if (RENDERER_BW == r) {
+              prv_dump(dump_dir, paths[p].name, "reference", size, reference, false);
+            }
+            for (int i = 0; i < size * size; ++i) {
+              image[i] -= reference[i];
+            }
+            char what[32];
+            snprintf(what, sizeof(what), "%s-error", s_renderer_names[r]);
+            prv_dump(dump_dir, paths[p].name, what, size, image, true);
+          }
+        }
+      }
+      fpath_deinit_context(&fctx);
+      gbitmap_destroy(target);
+      gbitmap_destroy(stepped);
+      gbitmap_destroy(mask);
+
+      // mean and bias are over the pixels either side thinks are covered.
+      const char *status = "ok";
+      if (inconsistent) {
+        status = "MASKS AND FILL DIFFER";
+        ++failures;
+      } else if (!update) {
+        const Golden *g = prv_find_golden(golden, num_golden, paths[p].name, s_renderer_names[r]);
+        if (!g) {
+          status = "NO GOLDEN";
+          ++failures;
+        } else if (g->checksum != checksum) {
+          status = "CHANGED";
+          ++failures;
+        }
+      }
+      printf("%-8s %-8s max %.3f  mean %.4f  bias %+.4f  %08x  %s\n", paths[p].name, s_renderer_names[r],
+             max_error, total_error / (touched ? touched : 1), total_bias / (touched ? touched : 1),
+             (unsigned int)checksum, status);
+      Golden *result = &results[num_results++];
+      snprintf(result->path, sizeof(result->path), "%s", paths[p].name);
+      snprintf(result->renderer, sizeof(result->renderer), "%s", s_renderer_names[r]);
+      result->checksum = checksum;
+    }
+
+    free(direct);
+    free(image);
+    free(reference);
+    free(points);
+    fpath_destroy(paths[p].path);
+  }
+
+  if (update) {
+    FILE *f = fopen(golden_file, "w");
+    if (!f) {
+      fprintf(stderr, "can't write %s\n", golden_file);
+      return 2;
+    }
+    fprintf(f, "# path renderer checksum, written by accuracy --update\n");
+    for (int k = 0; k < num_results; ++k) {
+      fprintf(f, "%s %s %08x\n", results[k].path, results[k].renderer, (unsigned int)results[k].checksum);
+    }
+    fclose(f);
+  }
+  if (failures) {
+    printf("%d failed\n", failures);
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+// Host check of the BW renderer against frames captured on a watch.
+//
+// Each capture is a screenshot of the demo's window, converted to a PBM,
+// with the firmware's own GPath fill of one of the demo paths.  The same
+// path is filled here with the BW renderer where the demo would put it, and
+// compared with the capture below its status bar.  GPath samples pixels by
+// a rule of its own, so the two disagree along the edges; every pixel where
+// they differ has to be within SLACK pixels of an edge of the capture, which
+// a misplaced, misrotated or misfilled path isn't.
+//
+//   device DIR
+//
+// reads the captures from DIR.  A capture is also checked at every rotation
+// that maps its path onto itself, to take the trig tables through a turn.
+#include <pebble.h>
+#include "fpath_builder.h"
+
+#define MAX_POINTS 256
+#define SLACK 1
+
+typedef struct {
+  const char *file;
+  const char *path;
+  GSize screen;
+  int16_t status_bar;   // rows at the top that the firmware draws
+  int symmetry;         // turns that map the path onto itself
+} Capture;
+
+// screenshots/screenshot1.png, the gpath-bezier demo on an aplite.
+static const Capture s_captures[] = {
+  { "aplite-bowtie.pbm", "bowtie", { 144, 168 }, 16, 2 },
+};
+
+static FPath *prv_build_path(const char *name) {
+  FPathBuilder *b = fpath_builder_create(MAX_POINTS);
+  if (0 == strcmp(name, "bowtie")) {
+    fpath_builder_move_to_point (b, FPointI(  0, -60));
+    fpath_builder_curve_to_point(b, FPointI( 60,   0), FPointI( 35, -60), FPointI( 60, -35));
+    fpath_builder_line_to_point (b, FPointI(-60,   0));
+    fpath_builder_curve_to_point(b, FPointI(  0,  60), FPointI(-60,  35), FPointI(-35,  60));
+    fpath_builder_line_to_point (b, FPointI(  0, -60));
+  }
+  FPath *path = fpath_builder_create_path(b);
+  fpath_builder_destroy(b);
+  return path;
+}
+
+// Reads a binary PBM, one bit a pixel from the most significant, 1 for black.
+static uint8_t *prv_read_pbm(const char *file, GSize size) {
+  FILE *f = fopen(file, "rb");
+  if (!f) {
+    fprintf(stderr, "can't read %s\n", file);
+    return NULL;
+  }
+  int w, h;
+  int stride = (size.w + 7) / 8;
+  uint8_t *bits = NULL;
+  if (2 == fscanf(f, "P4 %d %d", &w, &h) && w == size.w && h == size.h && '\n' == fgetc(f)) {
+    bits = malloc(stride * h);
+    if (bits && 1 != fread(bits, stride * h, 1, f)) {
+      free(bits);
+      bits = NULL;
+    }
+  }
+  if (!bits) {
+    fprintf(stderr, "%s isn't a %dx%d PBM\n", file, size.w, size.h);
+  }
+  fclose(f);
+  return bits;
+}
+
+// Whether the capture is lit at (x, y); off the screen counts as dark.  The
+// demo fills white on black, which a PBM stores as 0 on 1.
+static bool prv_lit(const uint8_t *bits, GSize size, int x, int y) {
+  if (x < 0 || y < 0 || x >= size.w || y >= size.h) {
+    return false;
+  }
+  return !((bits[y * ((size.w + 7) / 8) + x / 8] >> (7 - x % 8)) & 1);
+}
+
+// Whether a pixel of the capture has one within SLACK of it that is lit
+// otherwise, so that it is on an edge.
+static bool prv_near_edge(const uint8_t *bits, GSize size, int x, int y) {
+  bool lit = prv_lit(bits, size, x, y);
+  for (int dy = -SLACK; dy <= SLACK; ++dy) {
+    for (int dx = -SLACK; dx <= SLACK; ++dx) {
+      if (prv_lit(bits, size, x + dx, y + dy) != lit) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Fills the capture's path at one rotation and compares it, returning the
+// number of pixels that are off by more than the slack, or -1.
+static int prv_check(const Capture *capture, const uint8_t *bits, FPath *path, int32_t rotation) {
+  GBitmap *screen = gbitmap_create_blank(capture->screen, GBitmapFormat1Bit);
+  if (!screen) {
+    return -1;
+  }
+  FContext fctx;
+  fpath_init_context_bitmap_bw(&fctx, screen);
+  if (!fctx.flagBuffer) {
+    gbitmap_destroy(screen);
+    return -1;
+  }
+
+  // the demo centers the path in its window, below the status bar.
+  int16_t window_h = capture->screen.h - capture->status_bar;
+  fpath_move_to(path, FPointI(capture->screen.w / 2, capture->status_bar + window_h / 2));
+  fpath_rotate_to(path, rotation);
+  fpath_set_fill_color(&fctx, GColorWhite);
+  fpath_begin_fill(&fctx);
+  fpath_draw_filled(&fctx, path);
+  fpath_end_fill(&fctx);
+
+  int differ = 0;
+  int off = 0;
+  uint8_t *data = gbitmap_get_data(screen);
+  uint16_t stride = gbitmap_get_bytes_per_row(screen);
+  for (int y = capture->status_bar; y < capture->screen.h; ++y) {
+    for (int x = 0; x < capture->screen.w; ++x) {
+      bool lit = (data[y * stride + x / 8] >> (x % 8)) & 1;
+      if (lit != prv_lit(bits, capture->screen, x, y)) {
+        ++differ;
+        if (!prv_near_edge(bits, capture->screen, x, y)) {
+          ++off;
+        }
+      }
+    }
+  }
+  printf("%-20s %-8s turn %5.1f  %4d pixels differ, %d off an edge  %s\n", capture->file, capture->path,
+         rotation * 360.0 / TRIG_MAX_ANGLE, differ, off, off ? "FAILED" : "ok");
+
+  fpath_deinit_context(&fctx);
+  gbitmap_destroy(screen);
+  return off;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s DIR\n", argv[0]);
+    return 2;
+  }
+
+  int failures = 0;
+  for (size_t k = 0; k < ARRAY_LENGTH(s_captures); ++k) {
+    const Capture *capture = &s_captures[k];
+    char file[512];
+    snprintf(file, sizeof(file), "%s/%s", argv[1], capture->file);
+    uint8_t *bits = prv_read_pbm(file, capture->screen);
+    FPath *path = prv_build_path(capture->path);
+    if (!bits || !path) {
+      return 2;
+    }
+    for (int turn = 0; turn < capture->symmetry; ++turn) {
+      int off = prv_check(capture, bits, path, turn * TRIG_MAX_ANGLE / capture->symmetry);
+      if (off < 0) {
+        return 2;
+      }
+      failures += off > 0;
+    }
+    fpath_destroy(path);
+    free(bits);
+  }
+  return failures ? 1 : 0;
+}
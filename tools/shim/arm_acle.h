@@ -0,0 +1,30 @@
+#pragma once
+// The two ARM DSP intrinsics fpath uses, in plain C, so that a host build
+// with FPATH_DSP=1 runs the Cortex-M4 resolve loop and the checks can
+// compare it with the others.  The GE flags that the byte add sets for SEL
+// are kept per thread, as the CPU keeps them per context.
+#include <stdint.h>
+
+static __thread uint8_t shim_ge;
+
+static inline uint32_t __uadd8(uint32_t a, uint32_t b) {
+	uint32_t sum = 0;
+	shim_ge = 0;
+	for (int k = 0; k < 4; ++k) {
+		uint32_t s = ((a >> (8 * k)) & 0xff) + ((b >> (8 * k)) & 0xff);
+		if (s > 0xff) {
+			shim_ge |= 1 << k;
+		}
+		sum |= (s & 0xff) << (8 * k);
+	}
+	return sum;
+}
+
+static inline uint32_t __sel(uint32_t a, uint32_t b) {
+	uint32_t result = 0;
+	for (int k = 0; k < 4; ++k) {
+		uint32_t byte = 0xffu << (8 * k);
+		result |= (shim_ge & (1 << k) ? a : b) & byte;
+	}
+	return result;
+}
@@ -0,0 +1,215 @@
+#include <pebble.h>
+
+struct GBitmap {
+	uint8_t* data;
+	uint16_t stride;
+	GRect bounds;
+	GBitmapFormat format;
+};
+
+struct GContext {
+	GBitmap* frameBuffer;
+	bool captured;
+};
+
+// A quarter of a sine wave at every 64th angle, round(sin(k * 64 * 2 * pi /
+// TRIG_MAX_ANGLE) * TRIG_MAX_RATIO), and the rest by linear interpolation.
+static const uint16_t s_sine[257] = {
+	0x0000, 0x0192, 0x0324, 0x04b6, 0x0648, 0x07da, 0x096c, 0x0afe, 0x0c90, 0x0e21,
+	0x0fb3, 0x1144, 0x12d5, 0x1466, 0x15f7, 0x1787, 0x1918, 0x1aa8, 0x1c37, 0x1dc7,
+	0x1f56, 0x20e5, 0x2274, 0x2402, 0x2590, 0x271e, 0x28ab, 0x2a38, 0x2bc4, 0x2d50,
+	0x2edc, 0x3067, 0x31f1, 0x337b, 0x3505, 0x368e, 0x3817, 0x399f, 0x3b26, 0x3cad,
+	0x3e34, 0x3fb9, 0x413f, 0x42c3, 0x4447, 0x45ca, 0x474d, 0x48cf, 0x4a50, 0x4bd0,
+	0x4d50, 0x4ecf, 0x504d, 0x51cb, 0x5347, 0x54c3, 0x563e, 0x57b8, 0x5932, 0x5aaa,
+	0x5c22, 0x5d98, 0x5f0e, 0x6083, 0x61f7, 0x636a, 0x64dc, 0x664d, 0x67bd, 0x692d,
+	0x6a9b, 0x6c08, 0x6d74, 0x6edf, 0x7049, 0x71b2, 0x7319, 0x7480, 0x75e5, 0x774a,
+	0x78ad, 0x7a0f, 0x7b70, 0x7cd0, 0x7e2e, 0x7f8b, 0x80e7, 0x8242, 0x839c, 0x84f4,
+	0x864b, 0x87a1, 0x88f5, 0x8a48, 0x8b9a, 0x8cea, 0x8e39, 0x8f87, 0x90d3, 0x921e,
+	0x9368, 0x94b0, 0x95f6, 0x973b, 0x987f, 0x99c1, 0x9b02, 0x9c41, 0x9d7f, 0x9ebb,
+	0x9ff6, 0xa12f, 0xa267, 0xa39d, 0xa4d2, 0xa604, 0xa736, 0xa865, 0xa993, 0xaac0,
+	0xabeb, 0xad14, 0xae3b, 0xaf61, 0xb085, 0xb1a7, 0xb2c8, 0xb3e7, 0xb504, 0xb620,
+	0xb739, 0xb851, 0xb968, 0xba7c, 0xbb8e, 0xbc9f, 0xbdae, 0xbebb, 0xbfc7, 0xc0d0,
+	0xc1d8, 0xc2dd, 0xc3e1, 0xc4e3, 0xc5e3, 0xc6e1, 0xc7de, 0xc8d8, 0xc9d0, 0xcac7,
+	0xcbbb, 0xccae, 0xcd9e, 0xce8d, 0xcf79, 0xd064, 0xd14c, 0xd233, 0xd317, 0xd3fa,
+	0xd4da, 0xd5b9, 0xd695, 0xd76f, 0xd847, 0xd91e, 0xd9f2, 0xdac3, 0xdb93, 0xdc61,
+	0xdd2c, 0xddf6, 0xdebd, 0xdf82, 0xe045, 0xe106, 0xe1c5, 0xe281, 0xe33b, 0xe3f4,
+	0xe4a9, 0xe55d, 0xe60f, 0xe6be, 0xe76b, 0xe816, 0xe8be, 0xe965, 0xea09, 0xeaab,
+	0xeb4a, 0xebe7, 0xec82, 0xed1b, 0xedb2, 0xee46, 0xeed8, 0xef67, 0xeff5, 0xf07f,
+	0xf108, 0xf18e, 0xf212, 0xf294, 0xf313, 0xf390, 0xf40b, 0xf483, 0xf4f9, 0xf56d,
+	0xf5de, 0xf64d, 0xf6b9, 0xf723, 0xf78b, 0xf7f0, 0xf853, 0xf8b4, 0xf912, 0xf96d,
+	0xf9c7, 0xfa1e, 0xfa72, 0xfac4, 0xfb14, 0xfb61, 0xfbac, 0xfbf4, 0xfc3a, 0xfc7e,
+	0xfcbf, 0xfcfd, 0xfd3a, 0xfd73, 0xfdab, 0xfde0, 0xfe12, 0xfe42, 0xfe70, 0xfe9b,
+	0xfec3, 0xfeea, 0xff0d, 0xff2f, 0xff4d, 0xff6a, 0xff84, 0xff9b, 0xffb0, 0xffc3,
+	0xffd3, 0xffe0, 0xffeb, 0xfff4, 0xfffa, 0xfffe, 0xffff,
+};
+
+// The angle of every ratio k / 256 up to 1, as the first eighth of a turn,
+// round(atan(k / 256.0) * TRIG_MAX_ANGLE / (2 * pi)).
+static const uint16_t s_arctangent[257] = {
+	0x0000, 0x0029, 0x0051, 0x007a, 0x00a3, 0x00cc, 0x00f4, 0x011d, 0x0146, 0x016f,
+	0x0197, 0x01c0, 0x01e9, 0x0211, 0x023a, 0x0262, 0x028b, 0x02b4, 0x02dc, 0x0305,
+	0x032d, 0x0356, 0x037e, 0x03a7, 0x03cf, 0x03f7, 0x0420, 0x0448, 0x0470, 0x0499,
+	0x04c1, 0x04e9, 0x0511, 0x0539, 0x0561, 0x0589, 0x05b1, 0x05d9, 0x0601, 0x0629,
+	0x0651, 0x0678, 0x06a0, 0x06c8, 0x06ef, 0x0717, 0x073e, 0x0766, 0x078d, 0x07b5,
+	0x07dc, 0x0803, 0x082a, 0x0851, 0x0878, 0x089f, 0x08c6, 0x08ed, 0x0914, 0x093b,
+	0x0961, 0x0988, 0x09ae, 0x09d5, 0x09fb, 0x0a22, 0x0a48, 0x0a6e, 0x0a94, 0x0aba,
+	0x0ae0, 0x0b06, 0x0b2c, 0x0b51, 0x0b77, 0x0b9d, 0x0bc2, 0x0be7, 0x0c0d, 0x0c32,
+	0x0c57, 0x0c7c, 0x0ca1, 0x0cc6, 0x0ceb, 0x0d10, 0x0d34, 0x0d59, 0x0d7d, 0x0da2,
+	0x0dc6, 0x0dea, 0x0e0f, 0x0e33, 0x0e56, 0x0e7a, 0x0e9e, 0x0ec2, 0x0ee5, 0x0f09,
+	0x0f2c, 0x0f50, 0x0f73, 0x0f96, 0x0fb9, 0x0fdc, 0x0fff, 0x1021, 0x1044, 0x1067,
+	0x1089, 0x10ab, 0x10ce, 0x10f0, 0x1112, 0x1134, 0x1156, 0x1177, 0x1199, 0x11bb,
+	0x11dc, 0x11fd, 0x121f, 0x1240, 0x1261, 0x1282, 0x12a3, 0x12c3, 0x12e4, 0x1305,
+	0x1325, 0x1345, 0x1366, 0x1386, 0x13a6, 0x13c6, 0x13e6, 0x1405, 0x1425, 0x1444,
+	0x1464, 0x1483, 0x14a2, 0x14c1, 0x14e0, 0x14ff, 0x151e, 0x153d, 0x155b, 0x157a,
+	0x1598, 0x15b7, 0x15d5, 0x15f3, 0x1611, 0x162f, 0x164c, 0x166a, 0x1688, 0x16a5,
+	0x16c2, 0x16e0, 0x16fd, 0x171a, 0x1737, 0x1754, 0x1770, 0x178d, 0x17aa, 0x17c6,
+	0x17e2, 0x17fe, 0x181b, 0x1837, 0x1853, 0x186e, 0x188a, 0x18a6, 0x18c1, 0x18dd,
+	0x18f8, 0x1913, 0x192e, 0x1949, 0x1964, 0x197f, 0x199a, 0x19b4, 0x19cf, 0x19e9,
+	0x1a04, 0x1a1e, 0x1a38, 0x1a52, 0x1a6c, 0x1a86, 0x1a9f, 0x1ab9, 0x1ad3, 0x1aec,
+	0x1b05, 0x1b1f, 0x1b38, 0x1b51, 0x1b6a, 0x1b83, 0x1b9c, 0x1bb4, 0x1bcd, 0x1be5,
+	0x1bfe, 0x1c16, 0x1c2e, 0x1c46, 0x1c5e, 0x1c76, 0x1c8e, 0x1ca6, 0x1cbe, 0x1cd5,
+	0x1ced, 0x1d04, 0x1d1b, 0x1d33, 0x1d4a, 0x1d61, 0x1d78, 0x1d8e, 0x1da5, 0x1dbc,
+	0x1dd3, 0x1de9, 0x1dff, 0x1e16, 0x1e2c, 0x1e42, 0x1e58, 0x1e6e, 0x1e84, 0x1e9a,
+	0x1eb0, 0x1ec5, 0x1edb, 0x1ef0, 0x1f06, 0x1f1b, 0x1f30, 0x1f45, 0x1f5a, 0x1f6f,
+	0x1f84, 0x1f99, 0x1fae, 0x1fc3, 0x1fd7, 0x1fec, 0x2000,
+};
+
+// Linear interpolation in a table of 257 entries, at a position with the
+// given number of fraction bits.
+static int32_t prv_interpolate(const uint16_t* table, uint32_t position, int shift) {
+	uint32_t k = position >> shift;
+	int32_t fraction = position & ((1 << shift) - 1);
+	if (!fraction) {
+		return table[k];
+	}
+	int32_t step = table[k + 1] - table[k];
+	return table[k] + ((step * fraction + (1 << (shift - 1))) >> shift);
+}
+
+int32_t sin_lookup(int32_t angle) {
+	angle &= TRIG_MAX_ANGLE - 1;
+	// sin(a + pi) = -sin(a), and sin(pi - a) = sin(a).
+	bool negative = angle >= TRIG_MAX_ANGLE / 2;
+	angle &= TRIG_MAX_ANGLE / 2 - 1;
+	if (angle > TRIG_MAX_ANGLE / 4) {
+		angle = TRIG_MAX_ANGLE / 2 - angle;
+	}
+	int32_t ratio = prv_interpolate(s_sine, angle, 6);
+	return negative ? -ratio : ratio;
+}
+
+int32_t cos_lookup(int32_t angle) {
+	return sin_lookup(angle + TRIG_MAX_ANGLE / 4);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+	uint32_t ax = abs(x), ay = abs(y);
+	if (!ax && !ay) {
+		return 0;
+	}
+	// the angle in the first octant, and then folded out to the others.
+	int32_t angle;
+	if (ay <= ax) {
+		angle = prv_interpolate(s_arctangent, (ay << 16) / ax, 8);
+	} else {
+		angle = TRIG_MAX_ANGLE / 4 - prv_interpolate(s_arctangent, (ax << 16) / ay, 8);
+	}
+	if (x < 0) {
+		angle = TRIG_MAX_ANGLE / 2 - angle;
+	}
+	if (y < 0) {
+		angle = TRIG_MAX_ANGLE - angle;
+	}
+	return angle & (TRIG_MAX_ANGLE - 1);
+}
+
+uint16_t time_ms(time_t* tloc, uint16_t* out_ms) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint16_t ms = now.tv_nsec / 1000000;
+	if (tloc) {
+		*tloc = now.tv_sec;
+	}
+	if (out_ms) {
+		*out_ms = ms;
+	}
+	return ms;
+}
+
+bool grect_is_empty(const GRect* const rect) {
+	return rect->size.w == 0 && rect->size.h == 0;
+}
+
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format) {
+	GBitmap* bitmap = malloc(sizeof(GBitmap));
+	if (!bitmap) {
+		return NULL;
+	}
+	bitmap->format = format;
+	bitmap->bounds = GRect(0, 0, size.w, size.h);
+	bitmap->stride = GBitmapFormat1Bit == format ? (size.w + 31) / 32 * 4 : size.w;
+	bitmap->data = calloc(1, bitmap->stride * size.h);
+	if (!bitmap->data) {
+		free(bitmap);
+		return NULL;
+	}
+	return bitmap;
+}
+
+void gbitmap_destroy(GBitmap* bitmap) {
+	free(bitmap->data);
+	free(bitmap);
+}
+
+uint8_t* gbitmap_get_data(const GBitmap* bitmap) {
+	return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap) {
+	return bitmap->stride;
+}
+
+GRect gbitmap_get_bounds(const GBitmap* bitmap) {
+	return bitmap->bounds;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap) {
+	return bitmap->format;
+}
+
+GBitmap* graphics_capture_frame_buffer(GContext* ctx) {
+	// like the firmware, the frame buffer can't be captured twice.
+	if (ctx->captured) {
+		return NULL;
+	}
+	ctx->captured = true;
+	return ctx->frameBuffer;
+}
+
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer) {
+	ctx->captured = false;
+	return buffer == ctx->frameBuffer;
+}
+
+GContext* shim_context_create(GSize size, GBitmapFormat format) {
+	GContext* ctx = malloc(sizeof(GContext));
+	if (!ctx) {
+		return NULL;
+	}
+	ctx->frameBuffer = gbitmap_create_blank(size, format);
+	ctx->captured = false;
+	if (!ctx->frameBuffer) {
+		free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+void shim_context_destroy(GContext* ctx) {
+	gbitmap_destroy(ctx->frameBuffer);
+	free(ctx);
+}
+
+GBitmap* shim_context_get_bitmap(GContext* ctx) {
+	return ctx->frameBuffer;
+}
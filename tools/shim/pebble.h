@@ -0,0 +1,110 @@
+
+#pragma once
+// Just enough of the Pebble SDK to build the fpath library on a desktop
+// machine, for the tools in this directory.  Bitmaps are laid out as on the
+// watch: 1-bit rows padded to a multiple of 4 bytes, 8-bit rows one byte per
+// pixel.  A GContext is only a frame buffer.
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#define TRIG_MAX_ANGLE 0x10000
+#define TRIG_MAX_RATIO 0xffff
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+int32_t atan2_lookup(int16_t y, int16_t x);
+
+// Milliseconds from a monotonic clock, so the quality governor sees real frame times.
+uint16_t time_ms(time_t* tloc, uint16_t* out_ms);
+
+#define ARRAY_LENGTH(array) (sizeof((array)) / sizeof((array)[0]))
+
+typedef struct GPoint {
+	int16_t x;
+	int16_t y;
+} GPoint;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GPointZero GPoint(0, 0)
+
+typedef struct GSize {
+	int16_t w;
+	int16_t h;
+} GSize;
+#define GSize(w, h) ((GSize){(w), (h)})
+
+typedef struct GRect {
+	GPoint origin;
+	GSize size;
+} GRect;
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+bool grect_is_empty(const GRect* const rect);
+
+#ifdef PBL_COLOR
+typedef union GColor8 {
+	uint8_t argb;
+	struct {
+		uint8_t b:2;
+		uint8_t g:2;
+		uint8_t r:2;
+		uint8_t a:2;
+	};
+} GColor8;
+typedef GColor8 GColor;
+#define GColorClear ((GColor8){.argb = 0x00})
+#define GColorBlack ((GColor8){.argb = 0xC0})
+#define GColorRed   ((GColor8){.argb = 0xF0})
+#define GColorWhite ((GColor8){.argb = 0xFF})
+static inline bool gcolor_equal(GColor8 a, GColor8 b) {
+	return a.argb == b.argb;
+}
+#else
+typedef enum GColor {
+	GColorClear = ~0,
+	GColorBlack = 0,
+	GColorWhite = 1,
+} GColor;
+static inline bool gcolor_equal(GColor a, GColor b) {
+	return a == b;
+}
+#endif
+
+typedef enum GBitmapFormat {
+	GBitmapFormat1Bit,
+	GBitmapFormat8Bit,
+} GBitmapFormat;
+
+typedef struct GBitmap GBitmap;
+GBitmap* gbitmap_create_blank(GSize size, GBitmapFormat format);
+void gbitmap_destroy(GBitmap* bitmap);
+uint8_t* gbitmap_get_data(const GBitmap* bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap* bitmap);
+GRect gbitmap_get_bounds(const GBitmap* bitmap);
+GBitmapFormat gbitmap_get_format(const GBitmap* bitmap);
+
+typedef struct GContext GContext;
+GBitmap* graphics_capture_frame_buffer(GContext* ctx);
+bool graphics_release_frame_buffer(GContext* ctx, GBitmap* buffer);
+
+// Host only: a context drawing into a new frame buffer of the given size.
+GContext* shim_context_create(GSize size, GBitmapFormat format);
+void shim_context_destroy(GContext* ctx);
+GBitmap* shim_context_get_bitmap(GContext* ctx);
+
+typedef struct GPath {
+	uint32_t num_points;
+	GPoint* points;
+	int32_t rotation;
+	GPoint offset;
+} GPath;
+
+typedef enum {
+	APP_LOG_LEVEL_ERROR = 1,
+	APP_LOG_LEVEL_WARNING = 50,
+	APP_LOG_LEVEL_INFO = 100,
+	APP_LOG_LEVEL_DEBUG = 200,
+} AppLogLevel;
+#define APP_LOG(level, fmt, ...) fprintf(stderr, fmt "\n", ##__VA_ARGS__)
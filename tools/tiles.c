@@ -0,0 +1,759 @@
+// Offline tile-parallel renderer, and a check that tiles are exact.
+//
+// Renders the frames of an animated scene, read from a scene file, on a
+// canvas split into tiles.  Each (frame, tile) pair is an item of
+// work.  The items are dealt out to per-thread deques in runs of whole
+// frames; a thread takes items from the front of its own deque and, once
+// that is empty, steals the back half of another's.  Each thread draws with
+// a tile-sized bitmap context of its own, placed with fpath_set_origin and
+// given private flags, and copies each tile into its frame.
+//
+// The same frames are then rendered one after another by a single
+// full-size context, as the serial baseline, and every frame has to match
+// its tiled render exactly.  The throughput of both is logged for each
+// renderer, and the frames can be written out as PGM (BW) or PPM (color)
+// images.
+//
+//   tiles [-r RENDERER] [-j THREADS] [-t TILE] [-f FRAMES] [-o DIR] SCENE
+//
+// RENDERER is bw, aa, reduced or area (all of them by default).  THREADS
+// defaults to 4.  TILE is N for N by N tiles or WxH, with a width that is a
+// multiple of 8 pixels, or 0 for the canvas width.  It defaults to bands as
+// wide as the canvas and a quarter of its height: a tile has to walk every
+// edge to its left on its rows, so narrow tiles repeat the work of their
+// neighbours, while whole frames keep every thread busy on its own.  FRAMES
+// overrides the scene's frame count.  With -o each frame is written to
+// DIR/RENDERER-NNNN.pgm or .ppm.  The exit status is 1 if any frame
+// differs, and 2 for bad arguments or a bad scene.
+//
+// A scene file is a list of commands, one per line, with # starting a
+// comment.  Lengths are in pixels and angles in degrees, clockwise, and
+// either can have a fraction.
+//
+//   canvas W H                   the canvas size (180 by 180 by default)
+//   frames N                     the length of the animation (1 by default)
+//   path COLOR ... end           a path, drawn in order; COLOR is white,
+//                                black, red or an argb byte such as 0xf0
+//
+// Inside a path, its contours (each move starts a new one):
+//
+//   move X Y, line X Y           as the FPathBuilder functions
+//   curve X Y C1X C1Y C2X C2Y    a curve to (X, Y) with two control points
+//   circle R                     the fpath_primitives shapes, each as a
+//   arc R INNER FROM TO          contour of its own centered on (0, 0)
+//   rect W H R
+//
+// and how it moves:
+//
+//   at X Y                       its position at frame 0
+//   turn A                       its rotation at frame 0
+//   spin A                       rotation added each frame
+//   drift DX DY                  movement each frame, wrapping around the
+//                                canvas
+#include <pebble.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <math.h>
+#include "fpath_builder.h"
+#include "fpath_primitives.h"
+
+#define MAX_POINTS 1024
+#define MAX_THREADS 64
+#define MAX_TOKENS 8
+
+typedef enum {
+  RENDERER_BW,
+#ifdef PBL_COLOR
+  RENDERER_AA,
+  RENDERER_REDUCED,
+  RENDERER_AREA,
+#endif
+  RENDERER_COUNT
+} Renderer;
+
+static const char *s_renderer_names[] = {
+  "bw",
+#ifdef PBL_COLOR
+  "aa",
+  "reduced",
+  "area",
+#endif
+};
+
+typedef struct {
+  FPath *path;
+  GColor color;
+  fixed_t radius;           // bounds the path at any rotation
+  FPoint at;
+  double drift_x, drift_y;  // fixed point units per frame
+  double turn, spin;        // TRIG_MAX_ANGLE units
+} Shape;
+
+typedef struct {
+  int width, height;
+  int frames;
+  Shape *shapes;
+  int num_shapes;
+} Scene;
+
+typedef struct {
+  GBitmap *bitmap;
+  FContext fctx;
+} Canvas;
+
+// Items are numbered frame * tiles + tile, so a deque is a range of them:
+// its own thread takes from the front, thieves from the back.
+typedef struct {
+  pthread_mutex_t lock;
+  int front;
+  int back;
+} Deque;
+
+typedef struct {
+  int index;
+  pthread_t thread;
+  Deque deque;
+  Canvas canvas;
+  uint32_t items;
+  uint32_t steals;
+} Worker;
+
+// One renderer's run over the scene, read by all of the workers.
+typedef struct {
+  const Scene *scene;
+  Renderer renderer;
+  GSize tile;
+  int tiles_x, tiles_y;
+  GBitmap **frames;
+  Worker *workers;
+  int num_workers;
+} Run;
+
+static Run s_run;
+
+// --------------------------------------------------------------------------
+// Scene files.
+// --------------------------------------------------------------------------
+
+static fixed_t prv_fixed(double pixels) {
+  return (fixed_t)lround(pixels * FIXED_POINT_SCALE);
+}
+
+static double prv_angle(double degrees) {
+  return degrees * TRIG_MAX_ANGLE / 360;
+}
+
+static bool prv_parse_color(const char *name, GColor *color) {
+  long argb;
+  char *end;
+  if (0 == strcmp(name, "white")) {
+    argb = 0xff;
+  } else if (0 == strcmp(name, "black")) {
+    argb = 0xc0;
+  } else if (0 == strcmp(name, "red")) {
+    argb = 0xf0;
+  } else {
+    argb = strtol(name, &end, 0);
+    if (end == name || *end || argb < 0 || argb > 0xff) {
+      return false;
+    }
+  }
+#ifdef PBL_COLOR
+  *color = (GColor8){ .argb = (uint8_t)argb };
+#else
+  // BW draws anything that isn't black in white.
+  *color = (argb & 0x3f) ? GColorWhite : GColorBlack;
+#endif
+  return true;
+}
+
+// Parses the arguments of a command, which must be count numbers.
+static bool prv_parse_numbers(char **tokens, int num_tokens, int count, double *values) {
+  if (num_tokens != count + 1) {
+    return false;
+  }
+  for (int k = 0; k < count; ++k) {
+    char *end;
+    values[k] = strtod(tokens[k + 1], &end);
+    if (end == tokens[k + 1] || *end) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool prv_add_primitive(FPathBuilder *builder, FPath *primitive) {
+  bool ok = primitive->num_points > 0 && fpath_builder_move_to_point(builder, primitive->points[0]);
+  for (uint32_t k = 1; ok && k < primitive->num_points; ++k) {
+    ok = fpath_builder_line_to_point(builder, primitive->points[k]);
+  }
+  return ok;
+}
+
+// Carries out one command inside a path, returning false if it's unknown,
+// its arguments are wrong or the path is full.
+static bool prv_path_command(FPathBuilder *builder, Shape *shape, char **tokens, int num_tokens) {
+  static FPoint points[MAX_POINTS];
+  FPath primitive = { .points = points };
+  const char *command = tokens[0];
+  double v[6];
+
+  if (0 == strcmp(command, "move") && prv_parse_numbers(tokens, num_tokens, 2, v)) {
+    return fpath_builder_move_to_point(builder, FPoint(prv_fixed(v[0]), prv_fixed(v[1])));
+  }
+  if (0 == strcmp(command, "line") && prv_parse_numbers(tokens, num_tokens, 2, v)) {
+    return fpath_builder_line_to_point(builder, FPoint(prv_fixed(v[0]), prv_fixed(v[1])));
+  }
+  if (0 == strcmp(command, "curve") && prv_parse_numbers(tokens, num_tokens, 6, v)) {
+    return fpath_builder_curve_to_point(builder, FPoint(prv_fixed(v[0]), prv_fixed(v[1])),
+                                        FPoint(prv_fixed(v[2]), prv_fixed(v[3])),
+                                        FPoint(prv_fixed(v[4]), prv_fixed(v[5])));
+  }
+  if (0 == strcmp(command, "circle") && prv_parse_numbers(tokens, num_tokens, 1, v)) {
+    return fpath_make_circle(&primitive, MAX_POINTS, prv_fixed(v[0])) &&
+           prv_add_primitive(builder, &primitive);
+  }
+  if (0 == strcmp(command, "arc") && prv_parse_numbers(tokens, num_tokens, 4, v)) {
+    return fpath_make_arc(&primitive, MAX_POINTS, prv_fixed(v[0]), prv_fixed(v[1]),
+                          lround(prv_angle(v[2])), lround(prv_angle(v[3]))) &&
+           prv_add_primitive(builder, &primitive);
+  }
+  if (0 == strcmp(command, "rect") && prv_parse_numbers(tokens, num_tokens, 3, v)) {
+    return fpath_make_rounded_rect(&primitive, MAX_POINTS, (FSize){ prv_fixed(v[0]), prv_fixed(v[1]) },
+                                   prv_fixed(v[2])) &&
+           prv_add_primitive(builder, &primitive);
+  }
+  if (0 == strcmp(command, "at") && prv_parse_numbers(tokens, num_tokens, 2, v)) {
+    shape->at = FPoint(prv_fixed(v[0]), prv_fixed(v[1]));
+    return true;
+  }
+  if (0 == strcmp(command, "turn") && prv_parse_numbers(tokens, num_tokens, 1, v)) {
+    shape->turn = prv_angle(v[0]);
+    return true;
+  }
+  if (0 == strcmp(command, "spin") && prv_parse_numbers(tokens, num_tokens, 1, v)) {
+    shape->spin = prv_angle(v[0]);
+    return true;
+  }
+  if (0 == strcmp(command, "drift") && prv_parse_numbers(tokens, num_tokens, 2, v)) {
+    shape->drift_x = v[0] * FIXED_POINT_SCALE;
+    shape->drift_y = v[1] * FIXED_POINT_SCALE;
+    return true;
+  }
+  return false;
+}
+
+// The distance from the path origin to its farthest point, rounded up, and
+// a pixel more for the rounding of the rotation.
+static fixed_t prv_path_radius(FPath *path) {
+  double radius = 0;
+  for (uint32_t k = 0; k < path->num_points; ++k) {
+    double r = hypot(path->points[k].x, path->points[k].y);
+    if (r > radius) radius = r;
+  }
+  return (fixed_t)ceil(radius) + FIXED_POINT_SCALE;
+}
+
+static bool prv_load_scene(const char *file, Scene *scene) {
+  *scene = (Scene){ .width = 180, .height = 180, .frames = 1 };
+  FILE *f = fopen(file, "r");
+  if (!f) {
+    fprintf(stderr, "can't read %s\n", file);
+    return false;
+  }
+  FPathBuilder *builder = NULL;
+  Shape shape;
+  char line[256];
+  int line_number = 0;
+  const char *error = NULL;
+
+  while (!error && fgets(line, sizeof(line), f)) {
+    ++line_number;
+    char *comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+    char *tokens[MAX_TOKENS + 1];
+    int num_tokens = 0;
+    for (char *token = strtok(line, " \t\r\n"); token && num_tokens <= MAX_TOKENS;
+         token = strtok(NULL, " \t\r\n")) {
+      tokens[num_tokens++] = token;
+    }
+    if (!num_tokens) {
+      continue;
+    }
+    double v[2];
+
+    if (builder) {
+      if (0 == strcmp(tokens[0], "end") && 1 == num_tokens) {
+        shape.path = fpath_builder_create_path(builder);
+        fpath_builder_destroy(builder);
+        builder = NULL;
+        Shape *shapes = realloc(scene->shapes, (scene->num_shapes + 1) * sizeof(Shape));
+        if (shapes) {
+          scene->shapes = shapes;
+        }
+        if (!shape.path || !shapes) {
+          fpath_destroy(shape.path);
+          error = "the path is empty, or out of memory";
+        } else {
+          shape.radius = prv_path_radius(shape.path);
+          scene->shapes[scene->num_shapes++] = shape;
+        }
+      } else if (!prv_path_command(builder, &shape, tokens, num_tokens)) {
+        error = "unknown or bad path command, or too many points";
+      }
+    } else if (0 == strcmp(tokens[0], "canvas") && prv_parse_numbers(tokens, num_tokens, 2, v)) {
+      scene->width = (int)v[0];
+      scene->height = (int)v[1];
+      if (scene->width < 1 || scene->height < 1 || scene->width > 2048 || scene->height > 2048) {
+        error = "the canvas must be 1 to 2048 pixels on a side";
+      }
+    } else if (0 == strcmp(tokens[0], "frames") && prv_parse_numbers(tokens, num_tokens, 1, v)) {
+      scene->frames = (int)v[0];
+      if (scene->frames < 1) {
+        error = "there must be at least one frame";
+      }
+    } else if (0 == strcmp(tokens[0], "path") && 2 == num_tokens) {
+      shape = (Shape){ .at = FPointZero };
+      if (!prv_parse_color(tokens[1], &shape.color)) {
+        error = "unknown color";
+      } else if (!(builder = fpath_builder_create(MAX_POINTS))) {
+        error = "out of memory";
+      }
+    } else {
+      error = "unknown or bad command";
+    }
+  }
+  fclose(f);
+  if (!error && builder) {
+    error = "the last path has no end";
+  }
+  if (builder) {
+    fpath_builder_destroy(builder);
+  }
+  if (error) {
+    fprintf(stderr, "%s:%d: %s\n", file, line_number, error);
+    return false;
+  }
+  return true;
+}
+
+static void prv_free_scene(Scene *scene) {
+  for (int k = 0; k < scene->num_shapes; ++k) {
+    fpath_destroy(scene->shapes[k].path);
+  }
+  free(scene->shapes);
+}
+
+// --------------------------------------------------------------------------
+// Drawing.
+// --------------------------------------------------------------------------
+
+static fixed_t prv_wrap(fixed_t value, fixed_t size) {
+  return ((value % size) + size) % size;
+}
+
+// A shape's path placed for a frame.  The copy shares the points, so that
+// threads can place the same shape at once.
+static FPath prv_pose(const Scene *scene, const Shape *shape, int frame) {
+  FPath path = *shape->path;
+  path.rotation = (int32_t)lround(shape->turn + frame * shape->spin);
+  path.offset = shape->at;
+  if (shape->drift_x || shape->drift_y) {
+    path.offset.x = prv_wrap(path.offset.x + lround(frame * shape->drift_x), INT_TO_FIXED(scene->width));
+    path.offset.y = prv_wrap(path.offset.y + lround(frame * shape->drift_y), INT_TO_FIXED(scene->height));
+  }
+  return path;
+}
+
+// Whether a shape placed at offset misses the target of a context.  A closed
+// path wholly outside the target, even to its left, leaves it as it is.
+static bool prv_shape_misses(const FContext *fctx, const Shape *shape, FPoint offset) {
+  GRect bounds = gbitmap_get_bounds(fctx->target);
+  return offset.x + shape->radius < INT_TO_FIXED(fctx->origin.x) ||
+         offset.y + shape->radius < INT_TO_FIXED(fctx->origin.y) ||
+         offset.x - shape->radius > INT_TO_FIXED(fctx->origin.x + bounds.size.w) ||
+         offset.y - shape->radius > INT_TO_FIXED(fctx->origin.y + bounds.size.h);
+}
+
+static void prv_draw_frame(FContext *fctx, const Scene *scene, Renderer renderer, int frame) {
+  memset(gbitmap_get_data(fctx->target), 0,
+         gbitmap_get_bytes_per_row(fctx->target) * gbitmap_get_bounds(fctx->target).size.h);
+  for (int k = 0; k < scene->num_shapes; ++k) {
+    FPath path = prv_pose(scene, &scene->shapes[k], frame);
+    if (prv_shape_misses(fctx, &scene->shapes[k], path.offset)) {
+      continue;
+    }
+    fpath_set_fill_color(fctx, scene->shapes[k].color);
+#ifdef PBL_COLOR
+    if (RENDERER_AREA == renderer) {
+      fpath_fill_area(fctx, &path);
+      continue;
+    }
+#endif
+    fpath_begin_fill(fctx);
+    fpath_draw_filled(fctx, &path);
+    fpath_end_fill(fctx);
+  }
+}
+
+static GBitmapFormat prv_target_format(void) {
+#ifdef PBL_COLOR
+  return GBitmapFormat8Bit;
+#else
+  return GBitmapFormat1Bit;
+#endif
+}
+
+static bool prv_canvas_init(Canvas *canvas, Renderer renderer, GRect frame, bool private_flags) {
+  canvas->bitmap = gbitmap_create_blank(frame.size, prv_target_format());
+  if (!canvas->bitmap) {
+    return false;
+  }
+  FContext *fctx = &canvas->fctx;
+#ifdef PBL_COLOR
+  if (RENDERER_BW == renderer) {
+    fpath_init_context_bitmap_bw(fctx, canvas->bitmap);
+  } else {
+    fpath_init_context_bitmap_aa(fctx, canvas->bitmap);
+    if (RENDERER_REDUCED == renderer && !fpath_set_quality(fctx, FQualityReducedAA)) {
+      return false;
+    }
+  }
+#else
+  fpath_init_context_bitmap_bw(fctx, canvas->bitmap);
+#endif
+  fpath_set_stroke_color(fctx, GColorBlack);
+  fpath_set_origin(fctx, frame.origin);
+  return fctx->flagBuffer && (!private_flags || fpath_use_private_flags(fctx));
+}
+
+static void prv_canvas_deinit(Canvas *canvas) {
+  fpath_deinit_context(&canvas->fctx);
+  gbitmap_destroy(canvas->bitmap);
+}
+
+static int prv_pixel(GBitmap *bitmap, int x, int y) {
+  uint8_t *row = gbitmap_get_data(bitmap) + gbitmap_get_bytes_per_row(bitmap) * y;
+  if (GBitmapFormat1Bit == gbitmap_get_format(bitmap)) {
+    return (row[x / 8] >> (x % 8)) & 1;
+  }
+  return row[x];
+}
+
+// Copies the part of a tile that lies on the canvas into its frame.  Tiles
+// start on a multiple of 8 pixels, so 1-bit rows copy whole bytes.
+static void prv_copy_tile(GBitmap *tile, GBitmap *frame, GPoint origin) {
+  GRect bounds = gbitmap_get_bounds(frame);
+  GRect tile_bounds = gbitmap_get_bounds(tile);
+  int w = tile_bounds.size.w < bounds.size.w - origin.x ? tile_bounds.size.w : bounds.size.w - origin.x;
+  int h = tile_bounds.size.h < bounds.size.h - origin.y ? tile_bounds.size.h : bounds.size.h - origin.y;
+  uint16_t tile_stride = gbitmap_get_bytes_per_row(tile);
+  uint16_t frame_stride = gbitmap_get_bytes_per_row(frame);
+  bool bits = GBitmapFormat1Bit == gbitmap_get_format(frame);
+  int offset = bits ? origin.x / 8 : origin.x;
+  int bytes = bits ? (w + 7) / 8 : w;
+  for (int y = 0; y < h; ++y) {
+    memcpy(gbitmap_get_data(frame) + frame_stride * (origin.y + y) + offset,
+           gbitmap_get_data(tile) + tile_stride * y, bytes);
+  }
+}
+
+// --------------------------------------------------------------------------
+// Workers.
+// --------------------------------------------------------------------------
+
+// The next item from the front of a thread's own deque, or -1.
+static int prv_take(Deque *deque) {
+  int item = -1;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->front < deque->back) {
+    item = deque->front++;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return item;
+}
+
+// Moves the back half of another thread's deque into the thief's empty one.
+// Once every other deque is found empty the thief is done: items are only
+// ever moved by a thread that goes on to render them.
+static bool prv_steal(Worker *thief) {
+  for (int k = 1; k < s_run.num_workers; ++k) {
+    Worker *victim = &s_run.workers[(thief->index + k) % s_run.num_workers];
+    pthread_mutex_lock(&victim->deque.lock);
+    int back = victim->deque.back;
+    int count = (back - victim->deque.front + 1) / 2;
+    victim->deque.back -= count;
+    pthread_mutex_unlock(&victim->deque.lock);
+    if (count > 0) {
+      pthread_mutex_lock(&thief->deque.lock);
+      thief->deque.front = back - count;
+      thief->deque.back = back;
+      pthread_mutex_unlock(&thief->deque.lock);
+      ++thief->steals;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void prv_render_item(Worker *worker, int item) {
+  int tiles = s_run.tiles_x * s_run.tiles_y;
+  int frame = item / tiles;
+  int tile = item % tiles;
+  GPoint origin = GPoint((tile % s_run.tiles_x) * s_run.tile.w, (tile / s_run.tiles_x) * s_run.tile.h);
+  fpath_set_origin(&worker->canvas.fctx, origin);
+  prv_draw_frame(&worker->canvas.fctx, s_run.scene, s_run.renderer, frame);
+  prv_copy_tile(worker->canvas.bitmap, s_run.frames[frame], origin);
+  ++worker->items;
+}
+
+static void *prv_worker(void *data) {
+  Worker *worker = (Worker *)data;
+  for (;;) {
+    int item = prv_take(&worker->deque);
+    if (item >= 0) {
+      prv_render_item(worker, item);
+    } else if (!prv_steal(worker)) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+// --------------------------------------------------------------------------
+// Main.
+// --------------------------------------------------------------------------
+
+static double prv_now_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+// The number of pixels that differ between two renders of a frame.
+static uint32_t prv_compare_frame(GBitmap *a, GBitmap *b) {
+  GRect bounds = gbitmap_get_bounds(a);
+  uint32_t differ = 0;
+  for (int y = 0; y < bounds.size.h; ++y) {
+    for (int x = 0; x < bounds.size.w; ++x) {
+      if (prv_pixel(a, x, y) != prv_pixel(b, x, y)) {
+        ++differ;
+      }
+    }
+  }
+  return differ;
+}
+
+static bool prv_write_frame(const char *dir, Renderer renderer, int frame, GBitmap *bitmap) {
+  bool bits = GBitmapFormat1Bit == gbitmap_get_format(bitmap);
+  GRect bounds = gbitmap_get_bounds(bitmap);
+  char name[512];
+  snprintf(name, sizeof(name), "%s/%s-%04d.%s", dir, s_renderer_names[renderer], frame, bits ? "pgm" : "ppm");
+  FILE *f = fopen(name, "wb");
+  if (!f) {
+    fprintf(stderr, "can't write %s\n", name);
+    return false;
+  }
+  fprintf(f, "P%d\n%d %d\n255\n", bits ? 5 : 6, bounds.size.w, bounds.size.h);
+  for (int y = 0; y < bounds.size.h; ++y) {
+    for (int x = 0; x < bounds.size.w; ++x) {
+      int p = prv_pixel(bitmap, x, y);
+      if (bits) {
+        fputc(p ? 255 : 0, f);
+      } else {
+        // each channel of a GColor8 is two bits.
+        fputc(((p >> 4) & 3) * 85, f);
+        fputc(((p >> 2) & 3) * 85, f);
+        fputc((p & 3) * 85, f);
+      }
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Renders the scene tiled and then serially with one renderer, returning
+// the number of pixels that differ, or -1 if it couldn't be set up.
+static int64_t prv_run(const Scene *scene, Renderer renderer, GSize tile, int num_workers,
+                       const char *out_dir) {
+  Worker workers[MAX_THREADS];
+  GBitmap **frames = calloc(scene->frames, sizeof(GBitmap *));
+  s_run = (Run){
+    .scene = scene,
+    .renderer = renderer,
+    .tile = tile,
+    .tiles_x = (scene->width + tile.w - 1) / tile.w,
+    .tiles_y = (scene->height + tile.h - 1) / tile.h,
+    .frames = frames,
+    .workers = workers,
+    .num_workers = num_workers,
+  };
+  int tiles = s_run.tiles_x * s_run.tiles_y;
+
+  // everything is set up before any thread draws, since initializing a
+  // context touches the shared flag buffer pool.
+  bool ready = frames != NULL;
+  for (int k = 0; ready && k < scene->frames; ++k) {
+    frames[k] = gbitmap_create_blank(GSize(scene->width, scene->height), prv_target_format());
+    ready = frames[k] != NULL;
+    // touched now, so that the tiled run isn't timed faulting them in.
+    if (ready) {
+      memset(gbitmap_get_data(frames[k]), 0, gbitmap_get_bytes_per_row(frames[k]) * scene->height);
+    }
+  }
+  Canvas full;
+  ready = ready && prv_canvas_init(&full, renderer, GRect(0, 0, scene->width, scene->height), false);
+  for (int k = 0; k < num_workers; ++k) {
+    Worker *worker = &workers[k];
+    *worker = (Worker){ .index = k };
+    pthread_mutex_init(&worker->deque.lock, NULL);
+    // runs of whole frames, so that a thread's tiles share their paths.
+    worker->deque.front = (int)((int64_t)scene->frames * k / num_workers) * tiles;
+    worker->deque.back = (int)((int64_t)scene->frames * (k + 1) / num_workers) * tiles;
+    ready = ready && prv_canvas_init(&worker->canvas, renderer, GRect(0, 0, tile.w, tile.h), true);
+  }
+  if (!ready) {
+    fprintf(stderr, "can't set up the %s contexts\n", s_renderer_names[renderer]);
+    return -1;
+  }
+
+  // one untimed frame each way first, for the same warm start.
+  prv_draw_frame(&full.fctx, scene, renderer, 0);
+  for (int k = 0; k < num_workers; ++k) {
+    prv_draw_frame(&workers[k].canvas.fctx, scene, renderer, 0);
+  }
+
+  double begin = prv_now_ms();
+  for (int k = 0; k < num_workers; ++k) {
+    pthread_create(&workers[k].thread, NULL, prv_worker, &workers[k]);
+  }
+  uint32_t steals = 0, items = 0;
+  for (int k = 0; k < num_workers; ++k) {
+    pthread_join(workers[k].thread, NULL);
+    steals += workers[k].steals;
+    items += workers[k].items;
+  }
+  double tiled_ms = prv_now_ms() - begin;
+
+  // the serial baseline: each frame in one piece, on this thread.
+  double serial_ms = 0;
+  int64_t differ = 0;
+  for (int frame = 0; frame < scene->frames; ++frame) {
+    double frame_begin = prv_now_ms();
+    prv_draw_frame(&full.fctx, scene, renderer, frame);
+    serial_ms += prv_now_ms() - frame_begin;
+    differ += prv_compare_frame(full.bitmap, frames[frame]);
+  }
+  // a lost item leaves its tile blank, which the comparison catches unless
+  // the tile should be blank; the count catches that.
+  if (items != (uint32_t)(scene->frames * tiles)) {
+    printf("%u of %d items rendered\n", (unsigned int)items, scene->frames * tiles);
+    ++differ;
+  }
+
+  printf("%-8s serial %7.2f ms/frame %7.1f fps   %d tiles on %d threads %7.2f ms/frame %7.1f fps  "
+         "x%.2f  %u steals  %lld pixels differ  %s\n",
+         s_renderer_names[renderer], serial_ms / scene->frames, scene->frames * 1000.0 / serial_ms,
+         tiles, num_workers, tiled_ms / scene->frames, scene->frames * 1000.0 / tiled_ms,
+         serial_ms / tiled_ms, (unsigned int)steals, (long long)differ, differ ? "FRAMES DIFFER" : "ok");
+
+  for (int frame = 0; out_dir && frame < scene->frames; ++frame) {
+    if (!prv_write_frame(out_dir, renderer, frame, frames[frame])) {
+      break;
+    }
+  }
+
+  for (int k = 0; k < num_workers; ++k) {
+    prv_canvas_deinit(&workers[k].canvas);
+    pthread_mutex_destroy(&workers[k].deque.lock);
+  }
+  prv_canvas_deinit(&full);
+  for (int k = 0; k < scene->frames; ++k) {
+    gbitmap_destroy(frames[k]);
+  }
+  free(frames);
+  return differ;
+}
+
+static void prv_usage(void) {
+  fprintf(stderr, "usage: tiles [-r RENDERER] [-j THREADS] [-t TILE] [-f FRAMES] [-o DIR] SCENE\n"
+                  "  1 to %d threads, tile widths a multiple of 8 pixels or 0\n", MAX_THREADS);
+}
+
+int main(int argc, char **argv) {
+  int num_threads = 4;
+  GSize tile = GSize(0, 0);
+  int frames = 0;
+  int only = -1;
+  const char *out_dir = NULL;
+  int option;
+  while ((option = getopt(argc, argv, "r:j:t:f:o:")) != -1) {
+    switch (option) {
+      case 'r':
+        for (int r = 0; r < RENDERER_COUNT; ++r) {
+          if (0 == strcmp(optarg, s_renderer_names[r])) {
+            only = r;
+          }
+        }
+        if (only < 0) {
+          fprintf(stderr, "unknown renderer %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'j': num_threads = atoi(optarg); break;
+      case 't':
+        if (2 != sscanf(optarg, "%hdx%hd", &tile.w, &tile.h)) {
+          tile.w = tile.h = (int16_t)atoi(optarg);
+        }
+        break;
+      case 'f': frames = atoi(optarg); break;
+      case 'o': out_dir = optarg; break;
+      default: prv_usage(); return 2;
+    }
+  }
+  if (optind + 1 != argc || num_threads < 1 || num_threads > MAX_THREADS ||
+      tile.w < 0 || tile.w % 8 || tile.h < 0 || frames < 0) {
+    prv_usage();
+    return 2;
+  }
+
+  Scene scene;
+  if (!prv_load_scene(argv[optind], &scene)) {
+    prv_free_scene(&scene);
+    return 2;
+  }
+  if (frames) {
+    scene.frames = frames;
+  }
+  if (!tile.w) {
+    tile.w = scene.width;
+  }
+  if (!tile.h) {
+    tile.h = (scene.height + 3) / 4;
+  }
+  printf("%s: %d paths on %dx%d, %d frames, %dx%d tiles\n", argv[optind], scene.num_shapes,
+         scene.width, scene.height, scene.frames, tile.w, tile.h);
+
+  int failures = 0;
+  for (int r = 0; r < RENDERER_COUNT; ++r) {
+    if (only >= 0 && r != only) {
+      continue;
+    }
+    int64_t differ = prv_run(&scene, r, tile, num_threads, out_dir);
+    if (differ < 0) {
+      prv_free_scene(&scene);
+      return 2;
+    }
+    if (differ) {
+      ++failures;
+    }
+  }
+
+  prv_free_scene(&scene);
+  if (failures) {
+    printf("%d failed\n", failures);
+  }
+  return failures ? 1 : 0;
+}